@@ -0,0 +1,29 @@
+package com.google.android.gms.analytics;
+
+import android.content.Context;
+
+/**
+ * Stub of the Google Analytics (UA) API used by AnalyticsHelper, for the benchmark module only.
+ *
+ * Compiled in place of the Google Tag Manager dependency, so the benchmarks measure the helper's own
+ * overhead. Every call returns immediately without doing anything.
+ *
+ * @copyright Copyright (c) 2021 Adswerve. All rights reserved.
+ */
+public final class GoogleAnalytics {
+
+    private static final GoogleAnalytics sInstance = new GoogleAnalytics();
+
+    private GoogleAnalytics() {
+    }
+
+    public static GoogleAnalytics getInstance(Context context) {
+        return sInstance;
+    }
+
+    public void setLocalDispatchPeriod(int dispatchPeriodInSeconds) {
+    }
+
+    public void dispatchLocalHits() {
+    }
+}
@@ -0,0 +1,64 @@
+package com.google.firebase.analytics;
+
+import android.content.Context;
+import android.os.Bundle;
+
+import androidx.annotation.NonNull;
+import androidx.annotation.Nullable;
+
+import com.google.android.gms.tasks.Task;
+import com.google.android.gms.tasks.Tasks;
+
+/**
+ * Stub of the Firebase Analytics API used by AnalyticsHelper, for the benchmark module only.
+ *
+ * Compiled in place of the firebase-analytics dependency, so the benchmarks measure the helper's own
+ * overhead. Every call returns immediately without doing anything.
+ *
+ * @copyright Copyright (c) 2021 Adswerve. All rights reserved.
+ */
+public final class FirebaseAnalytics {
+
+    private static final FirebaseAnalytics sInstance = new FirebaseAnalytics();
+
+    /** Parameter names used by the benchmarks (same values as the real SDK). */
+    public static class Param {
+        public static final String CURRENCY = "currency";
+        public static final String ITEMS = "items";
+        public static final String ITEM_CATEGORY = "item_category";
+        public static final String ITEM_ID = "item_id";
+        public static final String ITEM_NAME = "item_name";
+        public static final String PRICE = "price";
+    }
+
+    private FirebaseAnalytics() {
+    }
+
+    @NonNull
+    public static FirebaseAnalytics getInstance(@NonNull Context context) {
+        return sInstance;
+    }
+
+    public void logEvent(@NonNull String name, @Nullable Bundle params) {
+    }
+
+    public void setDefaultEventParameters(@Nullable Bundle params) {
+    }
+
+    public void setUserProperty(@NonNull String name, @Nullable String value) {
+    }
+
+    public void setUserId(@Nullable String id) {
+    }
+
+    public void setAnalyticsCollectionEnabled(boolean enabled) {
+    }
+
+    public void resetAnalyticsData() {
+    }
+
+    @NonNull
+    public Task<String> getAppInstanceId() {
+        return Tasks.forResult("benchmark");
+    }
+}
@@ -0,0 +1,165 @@
+package YOUR_PACKAGE_HERE;
+
+import android.os.Bundle;
+
+import androidx.benchmark.BenchmarkState;
+import androidx.benchmark.junit4.BenchmarkRule;
+import androidx.test.core.app.ApplicationProvider;
+import androidx.test.ext.junit.runners.AndroidJUnit4;
+
+import com.google.firebase.analytics.FirebaseAnalytics;
+
+import org.junit.BeforeClass;
+import org.junit.Rule;
+import org.junit.Test;
+import org.junit.runner.RunWith;
+
+import java.util.ArrayList;
+
+/**
+ * Jetpack Microbenchmark benchmarks for the logging, validation, truncation, and timestamp paths of
+ * AnalyticsHelper.
+ *
+ * The benchmark module compiles against the stub Firebase and Google Analytics classes in
+ * "Benchmarks/Android stubs" instead of the real SDKs, so only the helper's own overhead is measured.
+ * Microbenchmark reports the time per operation, which is comparable with the per-call times of the
+ * Objective-C, Swift, and Kotlin benchmarks (which use the same scenarios and parameter values).
+ *
+ * @copyright Copyright (c) 2021 Adswerve. All rights reserved.
+ */
+@RunWith(AndroidJUnit4.class)
+public class AnalyticsHelperBenchmark {
+
+    @Rule
+    public BenchmarkRule mBenchmarkRule = new BenchmarkRule();
+
+    @BeforeClass
+    public static void configure() {
+        // measure the same work in debug and release builds: validation and truncation on
+        AnalyticsHelper.setValidateInDebug(true);
+        AnalyticsHelper.setValidateInProduction(true);
+        AnalyticsHelper.setTruncateStringValues(true);
+        AnalyticsHelper.configure(ApplicationProvider.getApplicationContext());
+    }
+
+
+    /**************** Fixtures ****************/
+
+    /**
+     * Returns event parameters named "param_1", "param_2", etc., with string values.
+     *
+     * @param count       Number of parameters.
+     * @param valueLength Length of each value (values over 100 characters are truncated by the helper).
+     */
+    private static Bundle makeParams(int count, int valueLength) {
+        StringBuilder value = new StringBuilder(valueLength);
+        for (int i = 0; i < valueLength; i++) {
+            value.append('v');
+        }
+        Bundle params = new Bundle();
+        for (int i = 1; i <= count; i++) {
+            params.putString("param_" + i, value.toString());
+        }
+        return params;
+    }
+
+    /**
+     * Returns Ecommerce parameters with an "items" list of products (each with an ID, name, category, and price).
+     *
+     * @param count Number of products.
+     */
+    private static Bundle makeItemsParams(int count) {
+        ArrayList<Bundle> items = new ArrayList<>(count);
+        for (int i = 1; i <= count; i++) {
+            Bundle product = new Bundle();
+            product.putString(FirebaseAnalytics.Param.ITEM_ID, "sku_" + i);
+            product.putString(FirebaseAnalytics.Param.ITEM_NAME, "Product " + i);
+            product.putString(FirebaseAnalytics.Param.ITEM_CATEGORY, "benchmark");
+            product.putDouble(FirebaseAnalytics.Param.PRICE, 9.99);
+            items.add(product);
+        }
+        Bundle params = new Bundle();
+        params.putString(FirebaseAnalytics.Param.CURRENCY, "USD");
+        params.putParcelableArrayList(FirebaseAnalytics.Param.ITEMS, items);
+        return params;
+    }
+
+
+    /**************** logEvent ****************/
+
+    /**
+     * Measures logging an event with the given number of parameters. The helper adds a timestamp
+     * parameter, so at most 24 keep the event within Firebase's limit of 25 (and off the validation
+     * error path).
+     */
+    private void measureLogEvent(int paramCount) {
+        Bundle params = makeParams(paramCount, 20);
+        BenchmarkState state = mBenchmarkRule.getState();
+        while (state.keepRunning()) {
+            AnalyticsHelper.logEvent("benchmark_event", params);
+        }
+    }
+
+    @Test
+    public void logEventWith1Parameter() {
+        measureLogEvent(1);
+    }
+
+    @Test
+    public void logEventWith10Parameters() {
+        measureLogEvent(10);
+    }
+
+    @Test
+    public void logEventWith24Parameters() {
+        measureLogEvent(24);
+    }
+
+
+    /**************** truncateParams ****************/
+
+    private void measureTruncateParams(int valueLength) {
+        Bundle params = makeParams(10, valueLength);
+        BenchmarkState state = mBenchmarkRule.getState();
+        while (state.keepRunning()) {
+            // truncateParams shortens values in place, so each operation gets a fresh copy (not measured)
+            state.pauseTiming();
+            Bundle copy = new Bundle(params);
+            state.resumeTiming();
+            AnalyticsHelper.truncateParams(copy);
+        }
+    }
+
+    @Test
+    public void truncateParamsShortValues() {
+        measureTruncateParams(20);
+    }
+
+    @Test
+    public void truncateParamsLongValues() {
+        measureTruncateParams(150);
+    }
+
+
+    /**************** Validation ****************/
+
+    @Test
+    public void validateItemsWith200Products() {
+        Bundle params = makeItemsParams(200);
+        BenchmarkState state = mBenchmarkRule.getState();
+        while (state.keepRunning()) {
+            AnalyticsHelper.checkParameters("benchmark_event", params);
+        }
+    }
+
+
+    /**************** Timestamp ****************/
+
+    @Test
+    public void getTimestamp() {
+        BenchmarkState state = mBenchmarkRule.getState();
+        while (state.keepRunning()) {
+            AnalyticsHelper.getTimestamp();
+        }
+    }
+}
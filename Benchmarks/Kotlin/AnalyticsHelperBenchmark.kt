@@ -0,0 +1,137 @@
+package YOUR_PACKAGE_HERE
+
+import android.os.Bundle
+import androidx.benchmark.junit4.BenchmarkRule
+import androidx.benchmark.junit4.measureRepeated
+import androidx.test.core.app.ApplicationProvider
+import androidx.test.ext.junit.runners.AndroidJUnit4
+import com.google.firebase.analytics.FirebaseAnalytics
+import org.junit.BeforeClass
+import org.junit.Rule
+import org.junit.Test
+import org.junit.runner.RunWith
+
+/**
+ * Jetpack Microbenchmark benchmarks for the logging, validation, truncation, and timestamp paths of
+ * AnalyticsHelper.
+ *
+ * The benchmark module compiles against the stub Firebase and Google Analytics classes in
+ * "Benchmarks/Android stubs" instead of the real SDKs, so only the helper's own overhead is measured.
+ * Microbenchmark reports the time per operation, which is comparable with the per-call times of the
+ * Objective-C, Swift, and Java benchmarks (which use the same scenarios and parameter values).
+ *
+ * @copyright Copyright (c) 2021 Adswerve. All rights reserved.
+ */
+@RunWith(AndroidJUnit4::class)
+class AnalyticsHelperBenchmark {
+
+    @get:Rule
+    val benchmarkRule = BenchmarkRule()
+
+    companion object {
+        @JvmStatic
+        @BeforeClass
+        fun configure() {
+            // measure the same work in debug and release builds: validation and truncation on
+            AnalyticsHelper.validateInDebug = true
+            AnalyticsHelper.validateInProduction = true
+            AnalyticsHelper.truncateStringValues = true
+            AnalyticsHelper.configure(ApplicationProvider.getApplicationContext())
+        }
+
+        /**
+         * Returns event parameters named "param_1", "param_2", etc., with string values.
+         *
+         * @param count Number of parameters.
+         * @param valueLength Length of each value (values over 100 characters are truncated by the helper).
+         */
+        private fun makeParams(count: Int, valueLength: Int): Bundle {
+            val value = "v".repeat(valueLength)
+            val params = Bundle()
+            for (i in 1..count) {
+                params.putString("param_$i", value)
+            }
+            return params
+        }
+
+        /**
+         * Returns Ecommerce parameters with an "items" list of products (each with an ID, name, category, and price).
+         *
+         * @param count Number of products.
+         */
+        private fun makeItemsParams(count: Int): Bundle {
+            val items = ArrayList<Bundle>(count)
+            for (i in 1..count) {
+                items.add(Bundle().apply {
+                    putString(FirebaseAnalytics.Param.ITEM_ID, "sku_$i")
+                    putString(FirebaseAnalytics.Param.ITEM_NAME, "Product $i")
+                    putString(FirebaseAnalytics.Param.ITEM_CATEGORY, "benchmark")
+                    putDouble(FirebaseAnalytics.Param.PRICE, 9.99)
+                })
+            }
+            return Bundle().apply {
+                putString(FirebaseAnalytics.Param.CURRENCY, "USD")
+                putParcelableArrayList(FirebaseAnalytics.Param.ITEMS, items)
+            }
+        }
+    }
+
+    /**************** logEvent ****************/
+
+    /**
+     * Measures logging an event with the given number of parameters. The helper adds a timestamp
+     * parameter, so at most 24 keep the event within Firebase's limit of 25 (and off the validation
+     * error path).
+     */
+    private fun measureLogEvent(paramCount: Int) {
+        val params = makeParams(paramCount, 20)
+        benchmarkRule.measureRepeated {
+            AnalyticsHelper.logEvent("benchmark_event", params)
+        }
+    }
+
+    @Test
+    fun logEventWith1Parameter() = measureLogEvent(1)
+
+    @Test
+    fun logEventWith10Parameters() = measureLogEvent(10)
+
+    @Test
+    fun logEventWith24Parameters() = measureLogEvent(24)
+
+    /**************** truncateParams ****************/
+
+    private fun measureTruncateParams(valueLength: Int) {
+        val params = makeParams(10, valueLength)
+        benchmarkRule.measureRepeated {
+            // truncateParams shortens values in place, so each operation gets a fresh copy (not measured)
+            val copy = runWithTimingDisabled { Bundle(params) }
+            AnalyticsHelper.truncateParams(copy)
+        }
+    }
+
+    @Test
+    fun truncateParamsShortValues() = measureTruncateParams(20)
+
+    @Test
+    fun truncateParamsLongValues() = measureTruncateParams(150)
+
+    /**************** Validation ****************/
+
+    @Test
+    fun validateItemsWith200Products() {
+        val params = makeItemsParams(200)
+        benchmarkRule.measureRepeated {
+            AnalyticsHelper.checkParameters("benchmark_event", params)
+        }
+    }
+
+    /**************** Timestamp ****************/
+
+    @Test
+    fun timestamp() {
+        benchmarkRule.measureRepeated {
+            AnalyticsHelper.timestamp
+        }
+    }
+}
@@ -0,0 +1,185 @@
+/**
+ * AAHAnalyticsHelperBenchmarks.m
+ *
+ * XCTest benchmarks for the logging, validation, truncation, and timestamp paths of AAHAnalyticsHelper.
+ *
+ * Firebase is replaced by a stub for the duration of the benchmarks (its class methods are swapped for
+ * empty implementations), so only the helper's own overhead is measured. Each measured block performs
+ * kBenchmarkOperations operations, so per-call times are comparable with the Swift, Java, and Kotlin
+ * benchmarks (which use the same scenarios and parameter values).
+ *
+ * Add this file to an XCTest target that links the app's analytics dependencies (see README).
+ *
+ * @copyright Copyright (c) 2021 Adswerve. All rights reserved.
+ */
+
+#import <XCTest/XCTest.h>
+#import <objc/runtime.h>
+#import "AAHAnalyticsHelper.h"
+@import Firebase;
+
+/** Number of operations per measured block. */
+static const NSUInteger kBenchmarkOperations = 1000;
+
+/** Private methods of the helper measured by the benchmarks. */
+@interface AAHAnalyticsHelper (Benchmarks)
++ (nullable NSDictionary *)truncateParams:(nullable NSDictionary *)parameters;
++ (void)checkParameters:(nonnull NSDictionary *)parameters source:(nonnull NSString *)source;
++ (nonnull NSString *)getTimestamp;
+@end
+
+@interface AAHAnalyticsHelperBenchmarks : XCTestCase
+@end
+
+@implementation AAHAnalyticsHelperBenchmarks
+
+/** Original implementations of the stubbed Firebase methods, restored after the benchmarks. */
+static NSMutableDictionary<NSString *, NSValue *> *_firebaseImplementations = nil;
+
+/**
+ * Replaces a Firebase class method with an empty implementation.
+ *
+ * @param selector Selector of the class method.
+ * @param stub Block with the method's signature (receiver first, then the arguments).
+ */
++ (void)stubFirebaseMethod:(SEL)selector withBlock:(id)stub {
+    Method method = class_getClassMethod([FIRAnalytics class], selector);
+    IMP original = method_setImplementation(method, imp_implementationWithBlock(stub));
+    _firebaseImplementations[NSStringFromSelector(selector)] = [NSValue valueWithPointer:(const void *)original];
+}
+
++ (void)setUp {
+    [super setUp];
+    _firebaseImplementations = [NSMutableDictionary dictionary];
+    [self stubFirebaseMethod:@selector(logEventWithName:parameters:) withBlock:^(id receiver, NSString *name, NSDictionary *parameters) {}];
+    [self stubFirebaseMethod:@selector(setUserPropertyString:forName:) withBlock:^(id receiver, NSString *value, NSString *name) {}];
+    [self stubFirebaseMethod:@selector(setUserID:) withBlock:^(id receiver, NSString *userID) {}];
+    [self stubFirebaseMethod:@selector(setDefaultEventParameters:) withBlock:^(id receiver, NSDictionary *parameters) {}];
+
+    // measure the same work in debug and release builds: validation and truncation on, everything else off
+    [AAHAnalyticsHelper setValidateInDebug:YES];
+    [AAHAnalyticsHelper setValidateInProduction:YES];
+    [AAHAnalyticsHelper setTruncateStringValues:YES];
+    [AAHAnalyticsHelper configure];
+}
+
++ (void)tearDown {
+    [_firebaseImplementations enumerateKeysAndObjectsUsingBlock:^(NSString *selector, NSValue *original, BOOL *stop) {
+        method_setImplementation(class_getClassMethod([FIRAnalytics class], NSSelectorFromString(selector)), (IMP)original.pointerValue);
+    }];
+    _firebaseImplementations = nil;
+    [super tearDown];
+}
+
+// MARK: - Fixtures
+
+/**
+ * Returns event parameters named "param_1", "param_2", etc., with string values.
+ *
+ * @param count Number of parameters.
+ * @param valueLength Length of each value (values over 100 characters are truncated by the helper).
+ */
++ (NSDictionary<NSString *, id> *)parametersWithCount:(NSUInteger)count valueLength:(NSUInteger)valueLength {
+    NSString *value = [@"" stringByPaddingToLength:valueLength withString:@"v" startingAtIndex:0];
+    NSMutableDictionary *parameters = [NSMutableDictionary dictionaryWithCapacity:count];
+    for (NSUInteger i = 1; i <= count; i++) {
+        parameters[[NSString stringWithFormat:@"param_%lu", (unsigned long)i]] = value;
+    }
+    return parameters;
+}
+
+/**
+ * Returns Ecommerce parameters with an "items" array of products (each with an ID, name, category, and price).
+ *
+ * @param count Number of products.
+ */
++ (NSDictionary<NSString *, id> *)itemsParametersWithCount:(NSUInteger)count {
+    NSMutableArray *items = [NSMutableArray arrayWithCapacity:count];
+    for (NSUInteger i = 1; i <= count; i++) {
+        [items addObject:@{
+            kFIRParameterItemID: [NSString stringWithFormat:@"sku_%lu", (unsigned long)i],
+            kFIRParameterItemName: [NSString stringWithFormat:@"Product %lu", (unsigned long)i],
+            kFIRParameterItemCategory: @"benchmark",
+            kFIRParameterPrice: @(9.99)
+        }];
+    }
+    return @{kFIRParameterCurrency: @"USD", kFIRParameterItems: items};
+}
+
+/** Metrics recorded by every benchmark. */
++ (NSArray<id<XCTMetric>> *)metrics {
+    return @[[[XCTClockMetric alloc] init], [[XCTCPUMetric alloc] init]];
+}
+
+// MARK: - logEventWithName:parameters:
+
+/**
+ * Measures logging an event with the given number of parameters. The helper adds a timestamp parameter,
+ * so at most 24 keep the event within Firebase's limit of 25 (and off the validation error path).
+ */
+- (void)measureLogEventWithParameterCount:(NSUInteger)count {
+    NSDictionary *parameters = [[self class] parametersWithCount:count valueLength:20];
+    [self measureWithMetrics:[[self class] metrics] block:^{
+        for (NSUInteger i = 0; i < kBenchmarkOperations; i++) {
+            [AAHAnalyticsHelper logEventWithName:@"benchmark_event" parameters:parameters];
+        }
+    }];
+}
+
+- (void)testLogEventWith1Parameter {
+    [self measureLogEventWithParameterCount:1];
+}
+
+- (void)testLogEventWith10Parameters {
+    [self measureLogEventWithParameterCount:10];
+}
+
+- (void)testLogEventWith24Parameters {
+    [self measureLogEventWithParameterCount:24];
+}
+
+// MARK: - truncateParams:
+
+- (void)measureTruncateParamsWithValueLength:(NSUInteger)valueLength {
+    NSDictionary *parameters = [[self class] parametersWithCount:10 valueLength:valueLength];
+    [self measureWithMetrics:[[self class] metrics] block:^{
+        for (NSUInteger i = 0; i < kBenchmarkOperations; i++) {
+            @autoreleasepool {
+                [AAHAnalyticsHelper truncateParams:parameters];
+            }
+        }
+    }];
+}
+
+- (void)testTruncateParamsShortValues {
+    [self measureTruncateParamsWithValueLength:20];
+}
+
+- (void)testTruncateParamsLongValues {
+    [self measureTruncateParamsWithValueLength:150];
+}
+
+// MARK: - Validation
+
+- (void)testValidateItemsWith200Products {
+    NSDictionary *parameters = [[self class] itemsParametersWithCount:200];
+    [self measureWithMetrics:[[self class] metrics] block:^{
+        for (NSUInteger i = 0; i < kBenchmarkOperations; i++) {
+            [AAHAnalyticsHelper checkParameters:parameters source:@"benchmark_event"];
+        }
+    }];
+}
+
+// MARK: - Timestamp
+
+- (void)testGetTimestamp {
+    [self measureWithMetrics:[[self class] metrics] block:^{
+        for (NSUInteger i = 0; i < kBenchmarkOperations; i++) {
+            @autoreleasepool {
+                [AAHAnalyticsHelper getTimestamp];
+            }
+        }
+    }];
+}
+
+@end
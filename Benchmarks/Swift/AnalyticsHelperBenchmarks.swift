@@ -0,0 +1,163 @@
+///
+/// AnalyticsHelperBenchmarks.swift
+///
+/// XCTest benchmarks for the logging, validation, truncation, and timestamp paths of AnalyticsHelper.
+///
+/// Firebase is replaced by a stub for the duration of the benchmarks (its class methods are swapped for
+/// empty implementations), so only the helper's own overhead is measured. Each measured block performs
+/// `operations` operations, so per-call times are comparable with the Objective-C, Java, and Kotlin
+/// benchmarks (which use the same scenarios and parameter values).
+///
+/// Add this file to an XCTest target of the app, and replace `YOUR_APP_MODULE` with the app's module name (see README).
+///
+/// @copyright Copyright (c) 2021 Adswerve. All rights reserved.
+///
+
+import XCTest
+import Firebase
+@testable import YOUR_APP_MODULE
+
+class AnalyticsHelperBenchmarks: XCTestCase {
+
+    /// Number of operations per measured block.
+    private static let operations = 1000
+
+    /// Original implementations of the stubbed Firebase methods, restored after the benchmarks.
+    private static var firebaseImplementations = [Selector: IMP]()
+
+    /// Replaces a Firebase class method with an empty implementation.
+    ///
+    /// - Parameters:
+    ///   - selector: Selector of the class method.
+    ///   - stub: Block with the method's signature (receiver first, then the arguments).
+    private static func stubFirebaseMethod(_ selector: Selector, with stub: Any) {
+        guard let method = class_getClassMethod(Analytics.self, selector) else {return}
+        firebaseImplementations[selector] = method_setImplementation(method, imp_implementationWithBlock(stub))
+    }
+
+    override class func setUp() {
+        super.setUp()
+        let logEvent: @convention(block) (AnyObject, NSString, NSDictionary?) -> Void = {_, _, _ in}
+        let setUserProperty: @convention(block) (AnyObject, NSString?, NSString) -> Void = {_, _, _ in}
+        let setUserID: @convention(block) (AnyObject, NSString?) -> Void = {_, _ in}
+        let setDefaultEventParameters: @convention(block) (AnyObject, NSDictionary?) -> Void = {_, _ in}
+        stubFirebaseMethod(#selector(Analytics.logEvent(_:parameters:)), with: logEvent)
+        stubFirebaseMethod(#selector(Analytics.setUserProperty(_:forName:)), with: setUserProperty)
+        stubFirebaseMethod(#selector(Analytics.setUserID(_:)), with: setUserID)
+        stubFirebaseMethod(#selector(Analytics.setDefaultEventParameters(_:)), with: setDefaultEventParameters)
+
+        // measure the same work in debug and release builds: validation and truncation on
+        AnalyticsHelper.validateInDebug = true
+        AnalyticsHelper.validateInProduction = true
+        AnalyticsHelper.truncateStringValues = true
+        AnalyticsHelper.configure()
+    }
+
+    override class func tearDown() {
+        for (selector, original) in firebaseImplementations {
+            if let method = class_getClassMethod(Analytics.self, selector) {
+                method_setImplementation(method, original)
+            }
+        }
+        firebaseImplementations.removeAll()
+        super.tearDown()
+    }
+
+    // MARK: - Fixtures
+
+    /// Returns event parameters named "param_1", "param_2", etc., with string values.
+    ///
+    /// - Parameters:
+    ///   - count: Number of parameters.
+    ///   - valueLength: Length of each value (values over 100 characters are truncated by the helper).
+    private func makeParameters(count: Int, valueLength: Int) -> [String: Any] {
+        let value = String(repeating: "v", count: valueLength)
+        var parameters = [String: Any](minimumCapacity: count)
+        for i in 1...count {
+            parameters["param_\(i)"] = value
+        }
+        return parameters
+    }
+
+    /// Returns Ecommerce parameters with an "items" array of products (each with an ID, name, category, and price).
+    ///
+    /// - Parameter count: Number of products.
+    private func makeItemsParameters(count: Int) -> [String: Any] {
+        let items: [[String: Any]] = (1...count).map { i in
+            [AnalyticsParameterItemID: "sku_\(i)",
+             AnalyticsParameterItemName: "Product \(i)",
+             AnalyticsParameterItemCategory: "benchmark",
+             AnalyticsParameterPrice: 9.99]
+        }
+        return [AnalyticsParameterCurrency: "USD", AnalyticsParameterItems: items]
+    }
+
+    /// Metrics recorded by every benchmark.
+    private let metrics: [XCTMetric] = [XCTClockMetric(), XCTCPUMetric()]
+
+    // MARK: - logEvent(_:parameters:)
+
+    /// Measures logging an event with `parameterCount` parameters. The helper adds a timestamp parameter,
+    /// so at most 24 keep the event within Firebase's limit of 25 (and off the validation error path).
+    private func measureLogEvent(parameterCount: Int) {
+        let parameters = makeParameters(count: parameterCount, valueLength: 20)
+        measure(metrics: metrics) {
+            for _ in 0..<Self.operations {
+                AnalyticsHelper.logEvent("benchmark_event", parameters: parameters)
+            }
+        }
+    }
+
+    func testLogEventWith1Parameter() {
+        measureLogEvent(parameterCount: 1)
+    }
+
+    func testLogEventWith10Parameters() {
+        measureLogEvent(parameterCount: 10)
+    }
+
+    func testLogEventWith24Parameters() {
+        measureLogEvent(parameterCount: 24)
+    }
+
+    // MARK: - truncateParams(_:)
+
+    private func measureTruncateParams(valueLength: Int) {
+        let parameters = makeParameters(count: 10, valueLength: valueLength)
+        measure(metrics: metrics) {
+            for _ in 0..<Self.operations {
+                _ = AnalyticsHelper.truncateParams(parameters)
+            }
+        }
+    }
+
+    func testTruncateParamsShortValues() {
+        measureTruncateParams(valueLength: 20)
+    }
+
+    func testTruncateParamsLongValues() {
+        measureTruncateParams(valueLength: 150)
+    }
+
+    // MARK: - Validation
+
+    func testValidateItemsWith200Products() {
+        let parameters = makeItemsParameters(count: 200)
+        measure(metrics: metrics) {
+            for _ in 0..<Self.operations {
+                AnalyticsHelper.checkParameters(parameters, source: "benchmark_event")
+            }
+        }
+    }
+
+    // MARK: - Timestamp
+
+    func testTimestamp() {
+        measure(metrics: metrics) {
+            for _ in 0..<Self.operations {
+                _ = AnalyticsHelper.timestamp
+            }
+        }
+    }
+
+} // AnalyticsHelperBenchmarks
@@ -3,11 +3,20 @@ package YOUR_PACKAGE_HERE;
 import android.annotation.SuppressLint;
 import android.app.Activity;
 import android.app.Application;
+import android.content.BroadcastReceiver;
 import android.content.Context;
+import android.content.Intent;
+import android.content.IntentFilter;
 import android.content.SharedPreferences;
+import android.net.ConnectivityManager;
+import android.net.Network;
+import android.net.NetworkCapabilities;
+import android.os.Build;
 import android.os.Bundle;
 import android.os.Parcelable;
+import android.os.SystemClock;
 import android.util.Log;
+import android.util.Pair;
 
 import YOUR_PACKAGE_HERE.BuildConfig;
 import com.google.android.gms.analytics.GoogleAnalytics;  // loaded by Google Tag Manager
@@ -16,14 +25,18 @@ import com.google.firebase.analytics.FirebaseAnalytics;
 import java.text.SimpleDateFormat;
 import java.util.ArrayList;
 import java.util.Date;
+import java.util.List;
 import java.util.Set;
 import java.util.TimeZone;
+import java.util.concurrent.ForkJoinPool;
+import java.util.concurrent.RecursiveAction;
 import java.util.regex.Matcher;
 import java.util.regex.Pattern;
 import java.util.regex.PatternSyntaxException;
 
 import androidx.annotation.NonNull;
 import androidx.annotation.Nullable;
+import androidx.annotation.VisibleForTesting;
 
 /**
  * Helper class to assist with common analytics implementation needs, including:
@@ -102,8 +115,11 @@ public class AnalyticsHelper {
 
     /* Private static variables. */
 
-    private static FirebaseAnalytics sFirebaseAnalytics = null;
+    private static volatile FirebaseAnalytics sFirebaseAnalytics = null;
+    private static volatile boolean sIsConfigured = false;
     private static final ForegroundMonitor sForegroundMonitor = new ForegroundMonitor();
+    private static final TimeZoneMonitor sTimeZoneMonitor = new TimeZoneMonitor();
+    private static final DispatchMonitor sDispatchMonitor = new DispatchMonitor();
 
     /* Private constructor to prevent instantiation. */
     private AnalyticsHelper() {
@@ -117,9 +133,29 @@ public class AnalyticsHelper {
      * Application#onCreate. Attempting to log events, etc. via this helper before calling
      * configure() will result in an IllegalStateException.
      *
+     * Safe to call from any thread. Configuration runs once; subsequent calls (including
+     * concurrent ones) return without doing anything, after a single volatile read.
+     *
      * @param context Context to retrieve FirebaseAnalytics and SharedPreferences.
      */
-    public synchronized static void configure(@NonNull final Context context) {
+    public static void configure(@NonNull final Context context) {
+        if (!sIsConfigured) {
+            synchronized (AnalyticsHelper.class) {
+                if (!sIsConfigured) {
+                    performConfiguration(context);
+                    sIsConfigured = true;
+                }
+            }
+        }
+    }
+
+    /**
+     * Sets initial state and refreshes user properties (see configure above). Runs exactly once,
+     * while holding the class lock.
+     *
+     * @param context Context to retrieve FirebaseAnalytics and SharedPreferences.
+     */
+    private static void performConfiguration(@NonNull final Context context) {
 
         // store reference to FirebaseAnalytics
         sFirebaseAnalytics = FirebaseAnalytics.getInstance(context.getApplicationContext());
@@ -127,6 +163,9 @@ public class AnalyticsHelper {
         // register for Activity lifecycle callbacks to detect app open/close
         ((Application) context.getApplicationContext()).registerActivityLifecycleCallbacks(sForegroundMonitor);
 
+        // register for timezone changes so cached timestamp formatters can be refreshed
+        context.getApplicationContext().registerReceiver(sTimeZoneMonitor, new IntentFilter(Intent.ACTION_TIMEZONE_CHANGED));
+
         // refresh user properties that may have changed since last launch
         setUserProperty(UserProperty.TIMEZONE_OFFSET, getTimezoneOffset());
         sFirebaseAnalytics.getAppInstanceId()
@@ -155,6 +194,9 @@ public class AnalyticsHelper {
         // set GA dispatch interval (only applicable if using GTM to send data to Universal Analytics)
         if (BuildConfig.DEBUG) {
             GoogleAnalytics.getInstance(context).setLocalDispatchPeriod(1);  // 1 second
+        } else {
+            // adapt the dispatch period to the connection type (see DispatchMonitor)
+            sDispatchMonitor.start(context.getApplicationContext());
         }
 
         // custom app update event (because GTM cannot see the auto app_update event on Android)
@@ -199,6 +241,124 @@ public class AnalyticsHelper {
         getFirebaseAnalytics().logEvent(name, sTruncateStringValues ? truncateParams(params) : params);
     }
 
+    /**
+     * Logs a batch of events, validating and truncating the whole batch in one pass before
+     * passing the events to Firebase in order.
+     *
+     * Validation and truncation settings are only evaluated once for the batch, which makes this
+     * more efficient than calling logEvent() for each event (e.g., for a burst of impressions).
+     *
+     * @param events          Pairs of event name and Bundle of event parameters (optional), in order.
+     * @param sharedTimestamp If true, all events in the batch get the same timestamp parameter.
+     */
+    public static void logEvents(@NonNull List<Pair<String, Bundle>> events, boolean sharedTimestamp) {
+        if (events.isEmpty()) {
+            return;
+        }
+
+        // evaluate state once for the whole batch
+        FirebaseAnalytics analytics = getFirebaseAnalytics();
+        boolean validate = isValidationEnabled();
+        boolean truncate = sTruncateStringValues;
+        String batchTimestamp = sharedTimestamp ? getTimestamp() : null;
+
+        // append additional parameters (timestamps are captured in order, on the calling thread)
+        // to a copy of each event's Bundle, since the same Bundle may appear more than once in a batch,
+        // and Bundles aren't safe to modify from several pool threads at once
+        Bundle[] prepared = new Bundle[events.size()];
+        for (int i = 0; i < prepared.length; i++) {
+            Pair<String, Bundle> event = events.get(i);
+            Bundle params = (null == event.second) ? new Bundle() : new Bundle(event.second);
+            params.putString(Param.TIMESTAMP, sharedTimestamp ? batchTimestamp : getTimestamp());
+            prepared[i] = params;
+        }
+
+        // validate and truncate each event, split across cores for large batches
+        if (validate || truncate) {
+            PrepareTask task = new PrepareTask(events, prepared, 0, prepared.length, validate, truncate);
+            if (prepared.length >= PrepareTask.PARALLEL_MIN_SIZE) {
+                getPreparePool().invoke(task);
+            } else {
+                task.prepare();
+            }
+        }
+
+        // log updated events to Firebase Analytics
+        for (int i = 0; i < prepared.length; i++) {
+            analytics.logEvent(events.get(i).first, prepared[i]);
+        }
+    }
+
+    /** Work-stealing pool for preparing large batches of events (see logEvents()). */
+    private static volatile ForkJoinPool sPreparePool;
+
+    /**
+     * Returns the pool used to prepare large batches of events, creating it on first use.
+     */
+    private static ForkJoinPool getPreparePool() {
+        if (null == sPreparePool) {
+            synchronized (AnalyticsHelper.class) {
+                if (null == sPreparePool) {
+                    sPreparePool = new ForkJoinPool();
+                }
+            }
+        }
+        return sPreparePool;
+    }
+
+    /**
+     * Validates and truncates a range of events in a batch, splitting the range in half until it
+     * is small enough to prepare directly. Each event is prepared independently, so the batch can
+     * still be passed to Firebase in its original order afterwards.
+     */
+    private static class PrepareTask extends RecursiveAction {
+        /** Smallest batch worth preparing in parallel. */
+        private static final int PARALLEL_MIN_SIZE = 128;
+        /** Number of events a task prepares directly rather than splitting. */
+        private static final int SPLIT_THRESHOLD = 32;
+
+        private final List<Pair<String, Bundle>> mEvents;
+        private final Bundle[] mPrepared;
+        private final int mStart;
+        private final int mEnd;
+        private final boolean mValidate;
+        private final boolean mTruncate;
+
+        PrepareTask(List<Pair<String, Bundle>> events, Bundle[] prepared, int start, int end, boolean validate, boolean truncate) {
+            mEvents = events;
+            mPrepared = prepared;
+            mStart = start;
+            mEnd = end;
+            mValidate = validate;
+            mTruncate = truncate;
+        }
+
+        @Override
+        protected void compute() {
+            if (mEnd - mStart <= SPLIT_THRESHOLD) {
+                prepare();
+            } else {
+                int middle = (mStart + mEnd) >>> 1;
+                invokeAll(new PrepareTask(mEvents, mPrepared, mStart, middle, mValidate, mTruncate),
+                        new PrepareTask(mEvents, mPrepared, middle, mEnd, mValidate, mTruncate));
+            }
+        }
+
+        /**
+         * Validates and truncates the task's events on the current thread.
+         */
+        void prepare() {
+            for (int i = mStart; i < mEnd; i++) {
+                if (mValidate) {
+                    checkEvent(mEvents.get(i).first, mPrepared[i]);
+                }
+                if (mTruncate) {
+                    mPrepared[i] = truncateParams(mPrepared[i]);
+                }
+            }
+        }
+    }
+
     /**
      * Wrapper for Firebase's setDefaultEventParameters method, providing an opportunity to
      * validate the parameters and enforce Firebase rules before passing them to Firebase.
@@ -295,7 +455,8 @@ public class AnalyticsHelper {
      * @param params Parameter bundle to evaluate.
      * @return Parameter bundle with string values shortened (if needed).
      */
-    private static Bundle truncateParams(Bundle params) {
+    @VisibleForTesting  // measured by the benchmarks
+    static Bundle truncateParams(Bundle params) {
         if (null != params) {
             Set<String> paramNames = params.keySet();
             for (String name : paramNames) {
@@ -470,25 +631,39 @@ public class AnalyticsHelper {
      * @param name   Name of the event.
      * @param params Bundle of event parameters (optional).
      */
-    @SuppressLint("DefaultLocale")
     private static void validateEvent(String name, Bundle params) {
         if (isValidationEnabled()) {
-            // validate event name
-            Matcher m = Validation.VALID_EVENT_NAME_REGEX.matcher(name);
-            boolean isInvalidName = !m.matches();
-            if (isInvalidName) {
-                String errorMessage = String.format("Invalid event name '%s'", name);
-                handleValidationError(errorMessage);
-            }
-            // validate parameter count
-            int parameterCount = (null == params) ? 0 : params.size();
-            boolean isInvalidCount = parameterCount > Validation.EVENT_MAX_PARAMETERS;
-            if (isInvalidCount) {
-                String errorMessage = String.format("Too many parameters in event '%s': contains %d, max %d", name, parameterCount, Validation.EVENT_MAX_PARAMETERS);
-                handleValidationError(errorMessage);
-            }
-            // validate parameters
-            validateParameters(name, params);
+            checkEvent(name, params);
+        }
+    }
+
+    /**
+     * Checks the event name, parameter count, and parameter names and values against the
+     * Firebase/GA4 rules, regardless of whether validation is enabled. (Callers are expected to
+     * check isValidationEnabled().)
+     *
+     * @param name   Name of the event.
+     * @param params Bundle of event parameters (optional).
+     */
+    @SuppressLint("DefaultLocale")
+    private static void checkEvent(String name, Bundle params) {
+        // validate event name
+        Matcher m = Validation.VALID_EVENT_NAME_REGEX.matcher(name);
+        boolean isInvalidName = !m.matches();
+        if (isInvalidName) {
+            String errorMessage = String.format("Invalid event name '%s'", name);
+            handleValidationError(errorMessage);
+        }
+        // validate parameter count
+        int parameterCount = (null == params) ? 0 : params.size();
+        boolean isInvalidCount = parameterCount > Validation.EVENT_MAX_PARAMETERS;
+        if (isInvalidCount) {
+            String errorMessage = String.format("Too many parameters in event '%s': contains %d, max %d", name, parameterCount, Validation.EVENT_MAX_PARAMETERS);
+            handleValidationError(errorMessage);
+        }
+        // validate parameters
+        if (null != params) {
+            checkParameters(name, params);
         }
     }
 
@@ -503,41 +678,53 @@ public class AnalyticsHelper {
      */
     private static void validateParameters(String source, Bundle params) {
         if (isValidationEnabled() && null != params) {
-            Set<String> paramNames = params.keySet();
-            for (String name : paramNames) {
-                // validate parameter name
-                Matcher m = Validation.VALID_PARAMETER_NAME_REGEX.matcher(name);
-                boolean isInvalidName = !m.matches();
-                if (isInvalidName) {
-                    String errorMessage = String.format("Invalid parameter name '%s' in '%s'", name, source);
-                    handleValidationError(errorMessage);
-                }
-                // validate parameter value
-                Object value = params.get(name);
-                if ("items".equals(name)) {
-                    // special handling required for Ecommerce "items" parameter, which may contain
-                    // an ArrayList<Bundle> or Parcelable[] of products
-                    if (value instanceof ArrayList) {
-                        for (Object product : (ArrayList) value) {
-                            if (product instanceof Bundle) {
-                                validateParameters(source + " [items]", (Bundle) product);
-                            }
-                        }
-                    } else if (value instanceof Parcelable[]) {
-                        for (Object product : (Parcelable[]) value) {
-                            if (product instanceof Bundle) {
-                                validateParameters(source + " [items]", (Bundle) product);
-                            }
+            checkParameters(source, params);
+        }
+    }
+
+    /**
+     * Checks each event parameter name and value against the Firebase/GA4 rules, regardless of
+     * whether validation is enabled. (Callers are expected to check isValidationEnabled().)
+     *
+     * @param source Source of the parameters (for error message use).
+     * @param params Bundle of event parameters.
+     */
+    @VisibleForTesting  // measured by the benchmarks
+    static void checkParameters(String source, @NonNull Bundle params) {
+        Set<String> paramNames = params.keySet();
+        for (String name : paramNames) {
+            // validate parameter name
+            Matcher m = Validation.VALID_PARAMETER_NAME_REGEX.matcher(name);
+            boolean isInvalidName = !m.matches();
+            if (isInvalidName) {
+                String errorMessage = String.format("Invalid parameter name '%s' in '%s'", name, source);
+                handleValidationError(errorMessage);
+            }
+            // validate parameter value
+            Object value = params.get(name);
+            if ("items".equals(name)) {
+                // special handling required for Ecommerce "items" parameter, which may contain
+                // an ArrayList<Bundle> or Parcelable[] of products
+                if (value instanceof ArrayList) {
+                    for (Object product : (ArrayList) value) {
+                        if (product instanceof Bundle) {
+                            checkParameters(source + " [items]", (Bundle) product);
                         }
                     }
-                } else {
-                    // normal event parameter
-                    boolean isInvalidValue = (value instanceof String) && value.toString().length() > Validation.PARAMETER_VALUE_MAX_LENGTH;
-                    if (isInvalidValue) {
-                        String errorMessage = String.format("Value too long for parameter '%s' in '%s': %s", name, source, value);
-                        handleValidationError(errorMessage);
+                } else if (value instanceof Parcelable[]) {
+                    for (Object product : (Parcelable[]) value) {
+                        if (product instanceof Bundle) {
+                            checkParameters(source + " [items]", (Bundle) product);
+                        }
                     }
                 }
+            } else {
+                // normal event parameter
+                boolean isInvalidValue = (value instanceof String) && value.toString().length() > Validation.PARAMETER_VALUE_MAX_LENGTH;
+                if (isInvalidValue) {
+                    String errorMessage = String.format("Value too long for parameter '%s' in '%s': %s", name, source, value);
+                    handleValidationError(errorMessage);
+                }
             }
         }
     }
@@ -620,6 +807,51 @@ public class AnalyticsHelper {
     }
 
 
+    /**************** Google Analytics (UA) dispatch ****************/
+
+
+    /**
+     * GA dispatch periods by connection type (production builds only), and estimates used for the
+     * dispatch statistics.
+     */
+    private static class Dispatch {
+        private static final int UNMETERED_PERIOD = 120;            // seconds
+        private static final int METERED_PERIOD = 1800;             // seconds (the GA SDK's default)
+        private static final int OFFLINE_PERIOD = 0;                // disables periodic dispatch
+        private static final long PIGGYBACK_MIN_GAP_MS = 30000;     // between piggybacked dispatches
+        private static final long OVERHEAD_BYTES = 4096;            // per dispatch (connection setup, TLS, and HTTP headers)
+    }
+
+    /**
+     * Reports that the app itself just used the network (e.g., an API request), so queued GA hits
+     * can piggyback on the radio being awake instead of waking it later. Cheap enough to call for
+     * every request.
+     *
+     * Hits are only sent early on metered networks (on unmetered networks the regular period is
+     * short anyway), and at most once every 30 seconds.
+     *
+     * FOR USE WITH GOOGLE TAG MANAGER, which imports the Google Analytics library and exposes the
+     * GoogleAnalytics methods.
+     */
+    public static void noteNetworkActivity() {
+        sDispatchMonitor.onAppNetworkActivity();
+    }
+
+    /**
+     * Returns the network-aware GA dispatcher's current state and counters.
+     *
+     * Keys: "dispatch_period" (seconds, 0 while offline), "piggybacked_dispatches", and estimates
+     * of the "dispatches_saved" and "bytes_saved" compared to dispatching every 120 seconds
+     * regardless of connection type.
+     *
+     * @return Bundle of statistics.
+     */
+    @NonNull
+    public static Bundle getDispatchStatistics() {
+        return sDispatchMonitor.getStatistics();
+    }
+
+
     /**************** Private SharedPreferences ****************/
 
 
@@ -680,17 +912,29 @@ public class AnalyticsHelper {
         return sFirebaseAnalytics;
     }
 
+    /* Timestamp format, e.g., 2020-02-11 11:26:02.868 GMT-0800 (PST). */
+    private static final String TIMESTAMP_FORMAT = "yyyy-MM-dd HH:mm:ss.SSS 'GMT'Z '('z')'";
+
+    /* Incremented whenever the device's timezone changes, to invalidate cached formatters. */
+    private static volatile int sTimeZoneGeneration = 0;
+
+    /* Per-thread timestamp formatter (SimpleDateFormat is not thread-safe and is expensive to create). */
+    private static final ThreadLocal<TimestampFormatter> sTimestampFormatter = new ThreadLocal<>();
+
     /**
      * Returns the current timestamp.
      *
      * @return String representation of current timestamp.
      */
-    @SuppressLint("SimpleDateFormat")
-    private static String getTimestamp() {
-        String format = "yyyy-MM-dd HH:mm:ss.SSS 'GMT'Z '('z')'"; // 2020-02-11 11:26:02.868 GMT-0800 (PST)
-        SimpleDateFormat formatter = new SimpleDateFormat(format);
-        formatter.setTimeZone(TimeZone.getDefault());
-        return formatter.format(new Date(System.currentTimeMillis()));
+    @VisibleForTesting  // measured by the benchmarks
+    static String getTimestamp() {
+        TimestampFormatter cached = sTimestampFormatter.get();
+        if (null == cached || cached.mGeneration != sTimeZoneGeneration) {
+            cached = new TimestampFormatter(sTimeZoneGeneration);
+            sTimestampFormatter.set(cached);
+        }
+        cached.mDate.setTime(System.currentTimeMillis());
+        return cached.mFormatter.format(cached.mDate);
     }
 
     /**
@@ -764,4 +1008,146 @@ public class AnalyticsHelper {
 
     } // ForegroundMonitor
 
+    /**
+     * Reusable formatter state for building timestamps, tagged with the timezone generation
+     * it was created for.
+     */
+    private static class TimestampFormatter {
+        private final int mGeneration;
+        private final SimpleDateFormat mFormatter;
+        private final Date mDate = new Date();
+
+        @SuppressLint("SimpleDateFormat")
+        TimestampFormatter(int generation) {
+            mGeneration = generation;
+            mFormatter = new SimpleDateFormat(TIMESTAMP_FORMAT);
+            mFormatter.setTimeZone(TimeZone.getDefault());
+        }
+    } // TimestampFormatter
+
+    /**
+     * This class follows the default network so the GA dispatch period can fit the connection:
+     * short on unmetered networks, long on metered ones (hits are held for fewer, bigger bursts),
+     * and disabled while offline. Hits held on a metered network or offline are dispatched as soon
+     * as an unmetered network is available.
+     *
+     * Requires the ACCESS_NETWORK_STATE permission and API 24 (on older versions the GA SDK's own
+     * period applies).
+     */
+    private static class DispatchMonitor extends ConnectivityManager.NetworkCallback {
+        private Context mContext;
+        private ConnectivityManager mConnectivityManager;
+        private int mAppliedPeriod = -1;            // -1 until the first callback
+        private long mAppliedAtMs = 0;
+        private long mLastDispatchAtMs = 0;
+        private long mPiggybackCount = 0;
+        private double mDispatchesSaved = 0;
+
+        /**
+         * Starts following the default network.
+         *
+         * @param context Application context.
+         */
+        synchronized void start(Context context) {
+            if (Build.VERSION.SDK_INT < Build.VERSION_CODES.N) {
+                return;
+            }
+            ConnectivityManager connectivityManager = (ConnectivityManager) context.getSystemService(Context.CONNECTIVITY_SERVICE);
+            if (null != connectivityManager) {
+                mContext = context;
+                mConnectivityManager = connectivityManager;
+                connectivityManager.registerDefaultNetworkCallback(this);
+            }
+        }
+
+        @Override
+        public void onAvailable(@NonNull Network network) {
+            // capabilities may not be reported separately on API 24 and 25
+            apply(mConnectivityManager.isActiveNetworkMetered() ? Dispatch.METERED_PERIOD : Dispatch.UNMETERED_PERIOD);
+        }
+
+        @Override
+        public void onCapabilitiesChanged(@NonNull Network network, @NonNull NetworkCapabilities capabilities) {
+            boolean isMetered = !capabilities.hasCapability(NetworkCapabilities.NET_CAPABILITY_NOT_METERED);
+            apply(isMetered ? Dispatch.METERED_PERIOD : Dispatch.UNMETERED_PERIOD);
+        }
+
+        @Override
+        public void onLost(@NonNull Network network) {
+            apply(Dispatch.OFFLINE_PERIOD);
+        }
+
+        /**
+         * Applies a dispatch period if it changed, and sends held hits once an unmetered network
+         * is available.
+         *
+         * @param period Dispatch period in seconds.
+         */
+        private synchronized void apply(int period) {
+            if (period == mAppliedPeriod) {
+                return;
+            }
+            accrueSavings();
+            boolean wasHolding = (Dispatch.METERED_PERIOD == mAppliedPeriod || Dispatch.OFFLINE_PERIOD == mAppliedPeriod);
+            mAppliedPeriod = period;
+            GoogleAnalytics analytics = GoogleAnalytics.getInstance(mContext);
+            analytics.setLocalDispatchPeriod(period);
+            if (wasHolding && Dispatch.UNMETERED_PERIOD == period) {
+                dispatch(analytics);
+            }
+        }
+
+        /**
+         * Dispatches queued hits while on a metered network, unless a dispatch happened recently.
+         */
+        synchronized void onAppNetworkActivity() {
+            if (Dispatch.METERED_PERIOD != mAppliedPeriod || SystemClock.elapsedRealtime() - mLastDispatchAtMs < Dispatch.PIGGYBACK_MIN_GAP_MS) {
+                return;
+            }
+            mPiggybackCount++;
+            dispatch(GoogleAnalytics.getInstance(mContext));
+        }
+
+        private void dispatch(GoogleAnalytics analytics) {
+            mLastDispatchAtMs = SystemClock.elapsedRealtime();
+            mDispatchesSaved -= 1;  // an extra dispatch on top of the periodic ones
+            analytics.dispatchLocalHits();
+        }
+
+        /**
+         * Adds the dispatches avoided since the last call to the running estimate.
+         */
+        private void accrueSavings() {
+            long now = SystemClock.elapsedRealtime();
+            if (0 != mAppliedAtMs && mAppliedPeriod >= 0) {
+                double elapsed = (now - mAppliedAtMs) / 1000.0;
+                double applied = (Dispatch.OFFLINE_PERIOD == mAppliedPeriod) ? 0 : elapsed / mAppliedPeriod;
+                mDispatchesSaved += elapsed / Dispatch.UNMETERED_PERIOD - applied;
+            }
+            mAppliedAtMs = now;
+        }
+
+        synchronized Bundle getStatistics() {
+            accrueSavings();
+            long dispatchesSaved = Math.max(0, (long) mDispatchesSaved);
+            Bundle statistics = new Bundle();
+            statistics.putInt("dispatch_period", Math.max(0, mAppliedPeriod));
+            statistics.putLong("piggybacked_dispatches", mPiggybackCount);
+            statistics.putLong("dispatches_saved", dispatchesSaved);
+            statistics.putLong("bytes_saved", dispatchesSaved * Dispatch.OVERHEAD_BYTES);
+            return statistics;
+        }
+    } // DispatchMonitor
+
+    /**
+     * This class listens for timezone changes so that cached timestamp formatters are rebuilt
+     * with the new default timezone. (Daylight saving transitions are handled by the formatter.)
+     */
+    private static class TimeZoneMonitor extends BroadcastReceiver {
+        @Override
+        public void onReceive(Context context, Intent intent) {
+            sTimeZoneGeneration++;
+        }
+    } // TimeZoneMonitor
+
 } // AnalyticsHelper
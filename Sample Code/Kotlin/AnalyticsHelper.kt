@@ -4,15 +4,26 @@ import android.annotation.SuppressLint
 import android.app.Activity
 import android.app.Application
 import android.app.Application.ActivityLifecycleCallbacks
+import android.content.BroadcastReceiver
 import android.content.Context
+import android.content.Intent
+import android.content.IntentFilter
 import android.content.SharedPreferences
+import android.net.ConnectivityManager
+import android.net.Network
+import android.net.NetworkCapabilities
+import android.os.Build
 import android.os.Bundle
+import android.os.SystemClock
 import android.util.Log
+import androidx.annotation.VisibleForTesting
 import YOUR_PACKAGE_HERE.BuildConfig
 import com.google.android.gms.analytics.GoogleAnalytics  // loaded by Google Tag Manager
 import com.google.firebase.analytics.FirebaseAnalytics
 import java.text.SimpleDateFormat
 import java.util.*
+import java.util.concurrent.ForkJoinPool
+import java.util.concurrent.RecursiveAction
 import java.util.regex.Pattern
 import java.util.regex.PatternSyntaxException
 
@@ -99,10 +110,29 @@ object AnalyticsHelper {
      * Application#onCreate. Attempting to log events, etc. via this helper before calling
      * configure() will result in an IllegalStateException.
      *
+     * Safe to call from any thread. Configuration runs once; subsequent calls (including
+     * concurrent ones) return without doing anything, after a single volatile read.
+     *
      * @param context Context to retrieve FirebaseAnalytics and SharedPreferences.
      */
-    @Synchronized
     fun configure(context: Context) {
+        if (!isConfigured) {
+            synchronized(this) {
+                if (!isConfigured) {
+                    performConfiguration(context)
+                    isConfigured = true
+                }
+            }
+        }
+    }
+
+    /**
+     * Sets initial state and refreshes user properties (see configure above). Runs exactly once,
+     * while holding the object's lock.
+     *
+     * @param context Context to retrieve FirebaseAnalytics and SharedPreferences.
+     */
+    private fun performConfiguration(context: Context) {
 
         // store reference to FirebaseAnalytics
         firebaseAnalytics = FirebaseAnalytics.getInstance(context.applicationContext)
@@ -110,6 +140,9 @@ object AnalyticsHelper {
         // register for Activity lifecycle callbacks to detect app open/close
         (context.applicationContext as Application).registerActivityLifecycleCallbacks(foregroundMonitor)
 
+        // register for timezone changes so cached timestamp formatters can be refreshed
+        context.applicationContext.registerReceiver(timeZoneMonitor, IntentFilter(Intent.ACTION_TIMEZONE_CHANGED))
+
         // refresh user properties that may have changed since last launch
         setUserProperty(UserProperty.TIMEZONE_OFFSET, timezoneOffset)
         firebaseAnalytics!!.appInstanceId
@@ -137,6 +170,9 @@ object AnalyticsHelper {
         // set GA dispatch interval (only applicable if using GTM to send data to Universal Analytics)
         if (BuildConfig.DEBUG) {
             GoogleAnalytics.getInstance(context).setLocalDispatchPeriod(1)  // 1 second
+        } else {
+            // adapt the dispatch period to the connection type (see DispatchMonitor)
+            dispatchMonitor.start(context.applicationContext)
         }
 
         // custom app update event (because GTM cannot see the auto app_update event on Android)
@@ -181,6 +217,100 @@ object AnalyticsHelper {
         firebaseAnalytics!!.logEvent(name, if (truncateStringValues) truncateParams(newParams) else newParams)
     }
 
+    /**
+     * Logs a batch of events, validating and truncating the whole batch in one pass before
+     * passing the events to Firebase in order.
+     *
+     * Validation and truncation settings are only evaluated once for the batch, which makes this
+     * more efficient than calling logEvent() for each event (e.g., for a burst of impressions).
+     *
+     * @param events          Pairs of event name and Bundle of event parameters (optional), in order.
+     * @param sharedTimestamp If true, all events in the batch get the same timestamp parameter.
+     */
+    fun logEvents(events: List<Pair<String, Bundle?>>, sharedTimestamp: Boolean = true) {
+        if (events.isEmpty()) return
+
+        // evaluate state once for the whole batch
+        val analytics = firebaseAnalytics!!
+        val validate = isValidationEnabled
+        val truncate = truncateStringValues
+        val batchTimestamp = if (sharedTimestamp) timestamp else null
+
+        // append additional parameters (timestamps are captured in order, on the calling thread)
+        // to a copy of each event's Bundle, since the same Bundle may appear more than once in a batch,
+        // and Bundles aren't safe to modify from several pool threads at once
+        val prepared = arrayOfNulls<Bundle>(events.size)
+        for (i in events.indices) {
+            val newParams = events[i].second?.let { Bundle(it) } ?: Bundle()
+            newParams.putString(Param.TIMESTAMP, batchTimestamp ?: timestamp)
+            prepared[i] = newParams
+        }
+
+        // validate and truncate each event, split across cores for large batches
+        if (validate || truncate) {
+            val task = PrepareTask(events, prepared, 0, prepared.size, validate, truncate)
+            if (prepared.size >= PrepareTask.PARALLEL_MIN_SIZE) {
+                preparePool.invoke(task)
+            } else {
+                task.prepare()
+            }
+        }
+
+        // log updated events to Firebase Analytics
+        for (i in events.indices) {
+            analytics.logEvent(events[i].first, prepared[i])
+        }
+    }
+
+    /** Work-stealing pool for preparing large batches of events (see logEvents()). */
+    private val preparePool: ForkJoinPool by lazy { ForkJoinPool() }
+
+    /**
+     * Validates and truncates a range of events in a batch, splitting the range in half until it
+     * is small enough to prepare directly. Each event is prepared independently, so the batch can
+     * still be passed to Firebase in its original order afterwards.
+     */
+    private class PrepareTask(
+        private val events: List<Pair<String, Bundle?>>,
+        private val prepared: Array<Bundle?>,
+        private val start: Int,
+        private val end: Int,
+        private val validate: Boolean,
+        private val truncate: Boolean
+    ) : RecursiveAction() {
+
+        companion object {
+            /** Smallest batch worth preparing in parallel. */
+            const val PARALLEL_MIN_SIZE = 128
+            /** Number of events a task prepares directly rather than splitting. */
+            const val SPLIT_THRESHOLD = 32
+        }
+
+        override fun compute() {
+            if (end - start <= SPLIT_THRESHOLD) {
+                prepare()
+            } else {
+                val middle = (start + end) ushr 1
+                invokeAll(PrepareTask(events, prepared, start, middle, validate, truncate),
+                        PrepareTask(events, prepared, middle, end, validate, truncate))
+            }
+        }
+
+        /**
+         * Validates and truncates the task's events on the current thread.
+         */
+        fun prepare() {
+            for (i in start until end) {
+                if (validate) {
+                    checkEvent(events[i].first, prepared[i])
+                }
+                if (truncate) {
+                    prepared[i] = truncateParams(prepared[i])
+                }
+            }
+        }
+    }
+
     /**
      * Wrapper for Firebase's setDefaultEventParameters method, providing an opportunity to
      * validate the parameters and enforce Firebase rules before passing them to Firebase.
@@ -277,7 +407,8 @@ object AnalyticsHelper {
      * @param params Parameter bundle to evaluate.
      * @return Parameter bundle with string values shortened (if needed).
      */
-    private fun truncateParams(params: Bundle?): Bundle? {
+    @VisibleForTesting  // measured by the benchmarks
+    internal fun truncateParams(params: Bundle?): Bundle? {
         if (null != params) {
             val paramNames = params.keySet()
             for (name in paramNames) {
@@ -428,25 +559,39 @@ object AnalyticsHelper {
      * @param name   Name of the event.
      * @param params Bundle of event parameters (optional).
      */
-    @SuppressLint("DefaultLocale")
     private fun validateEvent(name: String, params: Bundle?) {
         if (isValidationEnabled) {
-            // validate event name
-            val m = Validation.VALID_EVENT_NAME_REGEX!!.matcher(name)
-            val isInvalidName = !m.matches()
-            if (isInvalidName) {
-                val errorMessage = "Invalid event name '$name'"
-                handleValidationError(errorMessage)
-            }
-            // validate parameter count
-            val parameterCount = params?.size() ?: 0
-            val isInvalidCount = parameterCount > Validation.EVENT_MAX_PARAMETERS
-            if (isInvalidCount) {
-                val errorMessage = "Too many parameters in event '$name': contains $parameterCount, max ${Validation.EVENT_MAX_PARAMETERS}"
-                handleValidationError(errorMessage)
-            }
-            // validate parameters
-            validateParameters(name, params)
+            checkEvent(name, params)
+        }
+    }
+
+    /**
+     * Checks the event name, parameter count, and parameter names and values against the
+     * Firebase/GA4 rules, regardless of whether validation is enabled. (Callers are expected to
+     * check isValidationEnabled.)
+     *
+     * @param name   Name of the event.
+     * @param params Bundle of event parameters (optional).
+     */
+    @SuppressLint("DefaultLocale")
+    private fun checkEvent(name: String, params: Bundle?) {
+        // validate event name
+        val m = Validation.VALID_EVENT_NAME_REGEX!!.matcher(name)
+        val isInvalidName = !m.matches()
+        if (isInvalidName) {
+            val errorMessage = "Invalid event name '$name'"
+            handleValidationError(errorMessage)
+        }
+        // validate parameter count
+        val parameterCount = params?.size() ?: 0
+        val isInvalidCount = parameterCount > Validation.EVENT_MAX_PARAMETERS
+        if (isInvalidCount) {
+            val errorMessage = "Too many parameters in event '$name': contains $parameterCount, max ${Validation.EVENT_MAX_PARAMETERS}"
+            handleValidationError(errorMessage)
+        }
+        // validate parameters
+        if (null != params) {
+            checkParameters(name, params)
         }
     }
 
@@ -461,41 +606,53 @@ object AnalyticsHelper {
      */
     private fun validateParameters(source: String, params: Bundle?) {
         if (isValidationEnabled && null != params) {
-            val paramNames = params.keySet()
-            for (name in paramNames) {
-                // validate parameter name
-                val m = Validation.VALID_PARAMETER_NAME_REGEX!!.matcher(name)
-                val isInvalidName = !m.matches()
-                if (isInvalidName) {
-                    val errorMessage = "Invalid parameter name '$name' in '$source'"
-                    handleValidationError(errorMessage)
-                }
-                // validate parameter value
-                val value = params[name]
-                if ("items" == name) {
-                    // special handling required for Ecommerce "items" parameter, which may contain
-                    // an ArrayList<Bundle> or Array<Bundle> of products
-                    if (value is ArrayList<*>) {
-                        for (product in value) {
-                            if (product is Bundle) {
-                                validateParameters("$source [items]", product)
-                            }
-                        }
-                    } else if (value is Array<*>) {
-                        for (product in value) {
-                            if (product is Bundle) {
-                                validateParameters("$source [items]", product)
-                            }
+            checkParameters(source, params)
+        }
+    }
+
+    /**
+     * Checks each event parameter name and value against the Firebase/GA4 rules, regardless of
+     * whether validation is enabled. (Callers are expected to check isValidationEnabled.)
+     *
+     * @param source Source of the parameters (for error message use).
+     * @param params Bundle of event parameters.
+     */
+    @VisibleForTesting  // measured by the benchmarks
+    internal fun checkParameters(source: String, params: Bundle) {
+        val paramNames = params.keySet()
+        for (name in paramNames) {
+            // validate parameter name
+            val m = Validation.VALID_PARAMETER_NAME_REGEX!!.matcher(name)
+            val isInvalidName = !m.matches()
+            if (isInvalidName) {
+                val errorMessage = "Invalid parameter name '$name' in '$source'"
+                handleValidationError(errorMessage)
+            }
+            // validate parameter value
+            val value = params[name]
+            if ("items" == name) {
+                // special handling required for Ecommerce "items" parameter, which may contain
+                // an ArrayList<Bundle> or Array<Bundle> of products
+                if (value is ArrayList<*>) {
+                    for (product in value) {
+                        if (product is Bundle) {
+                            checkParameters("$source [items]", product)
                         }
                     }
-                } else {
-                    // normal event parameter
-                    val isInvalidValue = value is String && value.toString().length > Validation.PARAMETER_VALUE_MAX_LENGTH
-                    if (isInvalidValue) {
-                        val errorMessage = "Value too long for parameter '$name' in '$source': $value"
-                        handleValidationError(errorMessage)
+                } else if (value is Array<*>) {
+                    for (product in value) {
+                        if (product is Bundle) {
+                            checkParameters("$source [items]", product)
+                        }
                     }
                 }
+            } else {
+                // normal event parameter
+                val isInvalidValue = value is String && value.toString().length > Validation.PARAMETER_VALUE_MAX_LENGTH
+                if (isInvalidValue) {
+                    val errorMessage = "Value too long for parameter '$name' in '$source': $value"
+                    handleValidationError(errorMessage)
+                }
             }
         }
     }
@@ -578,6 +735,47 @@ object AnalyticsHelper {
     }
 
 
+    /**************** Google Analytics (UA) dispatch ****************/
+
+
+    /**
+     * GA dispatch periods by connection type (production builds only), and estimates used for the
+     * dispatch statistics.
+     */
+    private object Dispatch {
+        const val UNMETERED_PERIOD = 120            // seconds
+        const val METERED_PERIOD = 1800             // seconds (the GA SDK's default)
+        const val OFFLINE_PERIOD = 0                // disables periodic dispatch
+        const val PIGGYBACK_MIN_GAP_MS = 30000L     // between piggybacked dispatches
+        const val OVERHEAD_BYTES = 4096L            // per dispatch (connection setup, TLS, and HTTP headers)
+    }
+
+    /**
+     * Reports that the app itself just used the network (e.g., an API request), so queued GA hits
+     * can piggyback on the radio being awake instead of waking it later. Cheap enough to call for
+     * every request.
+     *
+     * Hits are only sent early on metered networks (on unmetered networks the regular period is
+     * short anyway), and at most once every 30 seconds.
+     *
+     * FOR USE WITH GOOGLE TAG MANAGER, which imports the Google Analytics library and exposes the
+     * GoogleAnalytics methods.
+     */
+    fun noteNetworkActivity() {
+        dispatchMonitor.onAppNetworkActivity()
+    }
+
+    /**
+     * The network-aware GA dispatcher's current state and counters.
+     *
+     * Keys: "dispatch_period" (seconds, 0 while offline), "piggybacked_dispatches", and estimates
+     * of the "dispatches_saved" and "bytes_saved" compared to dispatching every 120 seconds
+     * regardless of connection type.
+     */
+    val dispatchStatistics: Bundle
+        get() = dispatchMonitor.statistics
+
+
     /**************** Private SharedPreferences ****************/
 
 
@@ -626,27 +824,64 @@ object AnalyticsHelper {
      */
     private val foregroundMonitor = ForegroundMonitor()
 
+    /**
+     * Detects when the device's timezone changes. (See below.)
+     */
+    private val timeZoneMonitor = TimeZoneMonitor()
+
+    /**
+     * Network-aware GA dispatcher (production builds only).
+     */
+    private val dispatchMonitor = DispatchMonitor()
+
+    /**
+     * Indicates whether configure(context) has completed. Checked without the lock on every call
+     * to configure, so that only the first call pays for synchronization.
+     */
+    @Volatile
+    private var isConfigured = false
+
     /**
      * Reference to the FirebaseAnalytics instance.
      * 
      * @throws IllegalStateException if referenced before AnalyticsHelper#configure(context).
      */
+    @Volatile
     private var firebaseAnalytics: FirebaseAnalytics? = null
         get() {
             checkNotNull(field) { ERROR_MESSAGE_FAILED_TO_INIT }
             return field
         }
 
+    /**
+     * Timestamp format, e.g., 2020-02-11 11:26:02.868 GMT-0800 (PST).
+     */
+    private const val TIMESTAMP_FORMAT = "yyyy-MM-dd HH:mm:ss.SSS 'GMT'Z '('z')'"
+
+    /**
+     * Incremented whenever the device's timezone changes, to invalidate cached formatters.
+     */
+    @Volatile
+    private var timeZoneGeneration = 0
+
+    /**
+     * Per-thread timestamp formatter (SimpleDateFormat is not thread-safe and is expensive to create).
+     */
+    private val timestampFormatter = ThreadLocal<TimestampFormatter>()
+
     /**
      * String representation of current timestamp.
      */
-    @get:SuppressLint("SimpleDateFormat")
-    private val timestamp: String
+    @VisibleForTesting  // measured by the benchmarks
+    internal val timestamp: String
         get() {
-            val format = "yyyy-MM-dd HH:mm:ss.SSS 'GMT'Z '('z')'" // 2020-02-11 11:26:02.868 GMT-0800 (PST)
-            val formatter = SimpleDateFormat(format)
-            formatter.timeZone = TimeZone.getDefault()
-            return formatter.format(Date(System.currentTimeMillis()))
+            var cached = timestampFormatter.get()
+            if (null == cached || cached.generation != timeZoneGeneration) {
+                cached = TimestampFormatter(timeZoneGeneration)
+                timestampFormatter.set(cached)
+            }
+            cached.date.time = System.currentTimeMillis()
+            return cached.formatter.format(cached.date)
         }
 
     /**
@@ -703,4 +938,127 @@ object AnalyticsHelper {
 
     } // ForegroundMonitor
 
+    /**
+     * Reusable formatter state for building timestamps, tagged with the timezone generation
+     * it was created for.
+     */
+    @SuppressLint("SimpleDateFormat")
+    private class TimestampFormatter(val generation: Int) {
+        val formatter = SimpleDateFormat(TIMESTAMP_FORMAT).apply { timeZone = TimeZone.getDefault() }
+        val date = Date()
+    }
+
+    /**
+     * This class follows the default network so the GA dispatch period can fit the connection:
+     * short on unmetered networks, long on metered ones (hits are held for fewer, bigger bursts),
+     * and disabled while offline. Hits held on a metered network or offline are dispatched as soon
+     * as an unmetered network is available.
+     *
+     * Requires the ACCESS_NETWORK_STATE permission and API 24 (on older versions the GA SDK's own
+     * period applies).
+     */
+    private class DispatchMonitor : ConnectivityManager.NetworkCallback() {
+        private var context: Context? = null
+        private var connectivityManager: ConnectivityManager? = null
+        private var appliedPeriod = -1              // -1 until the first callback
+        private var appliedAtMs = 0L
+        private var lastDispatchAtMs = 0L
+        private var piggybackCount = 0L
+        private var dispatchesSaved = 0.0
+
+        /**
+         * Starts following the default network.
+         */
+        @Synchronized
+        fun start(context: Context) {
+            if (Build.VERSION.SDK_INT < Build.VERSION_CODES.N) return
+            val manager = context.getSystemService(Context.CONNECTIVITY_SERVICE) as? ConnectivityManager ?: return
+            this.context = context
+            connectivityManager = manager
+            manager.registerDefaultNetworkCallback(this)
+        }
+
+        override fun onAvailable(network: Network) {
+            // capabilities may not be reported separately on API 24 and 25
+            apply(if (connectivityManager?.isActiveNetworkMetered == true) Dispatch.METERED_PERIOD else Dispatch.UNMETERED_PERIOD)
+        }
+
+        override fun onCapabilitiesChanged(network: Network, capabilities: NetworkCapabilities) {
+            val isMetered = !capabilities.hasCapability(NetworkCapabilities.NET_CAPABILITY_NOT_METERED)
+            apply(if (isMetered) Dispatch.METERED_PERIOD else Dispatch.UNMETERED_PERIOD)
+        }
+
+        override fun onLost(network: Network) {
+            apply(Dispatch.OFFLINE_PERIOD)
+        }
+
+        /**
+         * Applies a dispatch period if it changed, and sends held hits once an unmetered network
+         * is available.
+         */
+        @Synchronized
+        private fun apply(period: Int) {
+            if (period == appliedPeriod) return
+            accrueSavings()
+            val wasHolding = (Dispatch.METERED_PERIOD == appliedPeriod || Dispatch.OFFLINE_PERIOD == appliedPeriod)
+            appliedPeriod = period
+            val analytics = GoogleAnalytics.getInstance(context)
+            analytics.setLocalDispatchPeriod(period)
+            if (wasHolding && Dispatch.UNMETERED_PERIOD == period) {
+                dispatch(analytics)
+            }
+        }
+
+        /**
+         * Dispatches queued hits while on a metered network, unless a dispatch happened recently.
+         */
+        @Synchronized
+        fun onAppNetworkActivity() {
+            if (Dispatch.METERED_PERIOD != appliedPeriod || SystemClock.elapsedRealtime() - lastDispatchAtMs < Dispatch.PIGGYBACK_MIN_GAP_MS) return
+            piggybackCount++
+            dispatch(GoogleAnalytics.getInstance(context))
+        }
+
+        private fun dispatch(analytics: GoogleAnalytics) {
+            lastDispatchAtMs = SystemClock.elapsedRealtime()
+            dispatchesSaved -= 1  // an extra dispatch on top of the periodic ones
+            analytics.dispatchLocalHits()
+        }
+
+        /**
+         * Adds the dispatches avoided since the last call to the running estimate.
+         */
+        private fun accrueSavings() {
+            val now = SystemClock.elapsedRealtime()
+            if (0L != appliedAtMs && appliedPeriod >= 0) {
+                val elapsed = (now - appliedAtMs) / 1000.0
+                val applied = if (Dispatch.OFFLINE_PERIOD == appliedPeriod) 0.0 else elapsed / appliedPeriod
+                dispatchesSaved += elapsed / Dispatch.UNMETERED_PERIOD - applied
+            }
+            appliedAtMs = now
+        }
+
+        val statistics: Bundle
+            @Synchronized get() {
+                accrueSavings()
+                val saved = maxOf(0L, dispatchesSaved.toLong())
+                return Bundle().apply {
+                    putInt("dispatch_period", maxOf(0, appliedPeriod))
+                    putLong("piggybacked_dispatches", piggybackCount)
+                    putLong("dispatches_saved", saved)
+                    putLong("bytes_saved", saved * Dispatch.OVERHEAD_BYTES)
+                }
+            }
+    } // DispatchMonitor
+
+    /**
+     * This class listens for timezone changes so that cached timestamp formatters are rebuilt
+     * with the new default timezone. (Daylight saving transitions are handled by the formatter.)
+     */
+    private class TimeZoneMonitor : BroadcastReceiver() {
+        override fun onReceive(context: Context, intent: Intent) {
+            timeZoneGeneration++
+        }
+    } // TimeZoneMonitor
+
 } // AnalyticsHelper
@@ -47,6 +47,9 @@ static NSString *const _Nonnull kAAHAnalyticsHelperParameterScreenName NS_SWIFT_
 static NSString *const _Nonnull kAAHAnalyticsHelperParameterScreenClass NS_SWIFT_NAME(AnalyticsHelperParameterScreenClass) = @"screen_class";
 static NSString *const _Nonnull kAAHAnalyticsHelperParameterTimestamp NS_SWIFT_NAME(AnalyticsHelperParameterTimestamp) = @"timestamp";
 static NSString *const _Nonnull kAAHAnalyticsHelperParameterErrorMessage NS_SWIFT_NAME(AnalyticsHelperParameterErrorMessage) = @"error_message";
+static NSString *const _Nonnull kAAHAnalyticsHelperParameterErrorCount NS_SWIFT_NAME(AnalyticsHelperParameterErrorCount) = @"error_count";
+static NSString *const _Nonnull kAAHAnalyticsHelperParameterErrorNames NS_SWIFT_NAME(AnalyticsHelperParameterErrorNames) = @"error_names";
+static NSString *const _Nonnull kAAHAnalyticsHelperParameterAggregateCount NS_SWIFT_NAME(AnalyticsHelperParameterAggregateCount) = @"aggregate_count";
 
 /** User property name constants (define all custom user property names here). */
 static NSString *const _Nonnull kAAHAnalyticsHelperUserPropertyEnvironment NS_SWIFT_NAME(AnalyticsHelperUserPropertyEnvironment) = @"environment";
@@ -54,6 +57,71 @@ static NSString *const _Nonnull kAAHAnalyticsHelperUserPropertyAppInstanceID NS_
 static NSString *const _Nonnull kAAHAnalyticsHelperUserPropertyTimezoneOffset NS_SWIFT_NAME(AnalyticsHelperUserPropertyTimezoneOffset) = @"timezone_offset";
 
 @class AAHAnalyticsHelper;
+@class AAHAnalyticsEvent;
+@class AAHEventBuilder;
+@class AAHDispatchPolicy;
+@protocol AAHEventSink;
+
+/** What asynchronous logging does when its buffer of pending events is full (see setOverflowPolicy:). */
+typedef NS_ENUM(NSInteger, AAHOverflowPolicy) {
+    AAHOverflowPolicyBlock,         // wait on the calling thread until there is room
+    AAHOverflowPolicyDropOldest     // discard the oldest pending event (or the new one, if the oldest entry is a setting)
+} NS_SWIFT_NAME(AnalyticsHelperOverflowPolicy);
+
+/**
+ * Returns the value of a dynamic event parameter for an event, or nil to leave it out (see setParameterProvider:forName:eventNames:).
+ */
+typedef id _Nullable (^AAHParameterProvider)(NSString *_Nonnull eventName) NS_SWIFT_NAME(AnalyticsHelperParameterProvider);
+
+// MARK: - Parameter lists
+
+/** Maximum number of parameters an AAHParameterList can hold (Firebase allows 25 per event). */
+#define AAH_PARAMETER_LIST_CAPACITY 32
+
+/**
+ * Fixed-size list of event parameters, for logging events from Objective-C or Objective-C++ without building
+ * a dictionary (see AAHLogEvent). Typically declared on the stack and filled with AAHParameterListSet.
+ *
+ * Names and values are not retained, so they must remain valid until the event has been logged.
+ */
+typedef struct AAHParameterList {
+    NSUInteger count;
+    __unsafe_unretained NSString *_Nonnull names[AAH_PARAMETER_LIST_CAPACITY];
+    __unsafe_unretained id _Nonnull values[AAH_PARAMETER_LIST_CAPACITY];
+} AAHParameterList;
+
+/**
+ * Sets a parameter in the list, replacing the value if the parameter is already set.
+ *
+ * @param list Parameter list to update.
+ * @param name Name of the parameter.
+ * @param value Value of the parameter.
+ * @return False if the list is full.
+ */
+NS_INLINE BOOL AAHParameterListSet(AAHParameterList *_Nonnull list, NSString *_Nonnull name, id _Nonnull value) {
+    for (NSUInteger i = 0; i < list->count; i++) {
+        if (list->names[i] == name || [list->names[i] isEqualToString:name]) {
+            list->values[i] = value;
+            return YES;
+        }
+    }
+    if (list->count >= AAH_PARAMETER_LIST_CAPACITY) {
+        return NO;
+    }
+    list->names[list->count] = name;
+    list->values[list->count] = value;
+    list->count++;
+    return YES;
+}
+
+/**
+ * Logs an event with parameters from a parameter list. (Same as AAHAnalyticsHelper's logEventWithName:parameterList:.)
+ *
+ * @param name The name of the event.
+ * @param parameters Optional list of event parameters.
+ */
+FOUNDATION_EXPORT void AAHLogEvent(NSString *_Nonnull name, const AAHParameterList *_Nullable parameters)
+NS_SWIFT_UNAVAILABLE("Use AnalyticsHelper.logEvent(_:parameters:)");
 
 @interface AAHAnalyticsHelper : NSObject {
 }
@@ -67,9 +135,70 @@ static NSString *const _Nonnull kAAHAnalyticsHelperUserPropertyTimezoneOffset NS
  * This method will be called automatically if needed when using the Firebase helper methods below; however,
  * to set initial state as early as possible in the app's startup process, calling this manually immediately after
  * calling `[FIRApp configure]` is recommended.
+ *
+ * Safe to call from any thread. Configuration runs once; subsequent calls return without doing anything.
  */
 + (void)configure NS_SWIFT_NAME(configure());
 
+/**
+ * Controls whether configure defers its work off the app's critical startup path. Default is false.
+ *
+ * When enabled, configure only marks the helper ready and queues events in memory. The user property
+ * refresh and GA dispatch setup run on a utility QoS queue, after which queued events are passed to
+ * Firebase in order. Must be called before configure.
+ */
++ (void)setDeferredConfiguration:(BOOL)enable;
+
+/**
+ * Controls whether events are written to an on-disk journal as they enter the helper, so that events
+ * Firebase had not yet accepted when the process was killed are logged on the next launch. Default is
+ * false. Must be called before configure, which replays the journal.
+ */
++ (void)setEventJournalEnabled:(BOOL)enable;
+
+/**
+ * Returns the number of events logged but not journaled because more than 256 journaled events were still
+ * waiting for Firebase.
+ */
++ (NSUInteger)unjournaledEventCount;
+
+/**
+ * Controls whether validation, truncation, and the hand-off to Firebase happen on a serial background
+ * queue instead of the calling thread. Default is false.
+ *
+ * When enabled, logEventWithName:parameters: only captures the timestamp and a (shallow) copy of its
+ * inputs, and writes them to a bounded lock-free buffer, before returning. Events, user properties,
+ * and other settings are still passed to Firebase in the order they were called.
+ */
++ (void)setAsynchronousLogging:(BOOL)enable;
+
+/**
+ * Controls what happens when the asynchronous logging buffer is full. Default is AAHOverflowPolicyBlock.
+ */
++ (void)setOverflowPolicy:(AAHOverflowPolicy)policy;
+
+/**
+ * Returns the number of events dropped because the asynchronous logging buffer was full.
+ */
++ (NSUInteger)droppedEventCount;
+
+/**
+ * Caps the estimated memory held by events queued for asynchronous logging. Once the cap is reached, new
+ * events are handled according to the overflow policy. Default is 0 (no cap).
+ */
++ (void)setPendingMemoryLimit:(NSUInteger)bytes;
+
+/**
+ * Indicates whether asynchronous logging has hit its buffer capacity or memory cap since its buffer was
+ * last empty (e.g., to slow down a burst of events).
+ */
++ (BOOL)isUnderBackPressure;
+
+/**
+ * Blocks until all events and settings queued by asynchronous logging have been passed to Firebase.
+ */
++ (void)waitForPendingEvents;
+
 // MARK: - Firebase helpers
 
 /**
@@ -82,6 +211,43 @@ static NSString *const _Nonnull kAAHAnalyticsHelperUserPropertyTimezoneOffset NS
 + (void)logEventWithName:(nonnull NSString *)name parameters:(nullable NSDictionary<NSString *, id> *)parameters
 NS_SWIFT_NAME(logEvent(_:parameters:));
 
+/**
+ * Logs a batch of events, validating and truncating the whole batch in one pass before passing the
+ * events to Firebase in order.
+ *
+ * Configuration and validation state are only evaluated once for the batch, which makes this more
+ * efficient than calling logEventWithName:parameters: for each event (e.g., for a burst of impressions).
+ *
+ * @param events Events to log, in order.
+ * @param sharedTimestamp If true, all events in the batch get the same timestamp parameter.
+ */
++ (void)logEvents:(nonnull NSArray<AAHAnalyticsEvent *> *)events sharedTimestamp:(BOOL)sharedTimestamp
+NS_SWIFT_NAME(logEvents(_:sharedTimestamp:));
+
+/**
+ * Logs an event built from a registered event schema (see AAHEventSchema).
+ *
+ * Event and parameter names were checked when the schema was registered, so only the bounded checks
+ * on string value lengths remain. The builder is not retained and may be reset and reused immediately.
+ *
+ * @param builder Builder holding the event's parameter values.
+ */
++ (void)logEventWithBuilder:(nonnull AAHEventBuilder *)builder
+NS_SWIFT_NAME(logEvent(_:));
+
+/**
+ * Logs an event with parameters from a parameter list (see AAHParameterList), so the only dictionary
+ * built is the one passed to Firebase.
+ *
+ * The list is processed on the calling thread. If the event must be kept beyond the call (asynchronous
+ * logging, the event journal, or aggregation), the list is converted into a dictionary up front instead.
+ *
+ * @param name The name of the event.
+ * @param parameterList Optional list of event parameters.
+ */
++ (void)logEventWithName:(nonnull NSString *)name parameterList:(nullable const AAHParameterList *)parameterList
+NS_SWIFT_UNAVAILABLE("Use logEvent(_:parameters:)");
+
 /**
  * Wrapper for Firebase's setDefaultEventParameters method, providing an opportunity to
  * validate the parameters before passing them to Firebase.
@@ -148,6 +314,84 @@ NS_SWIFT_NAME(trimParam(_:));
 + (nullable NSString *)truncateUserProp:(nullable NSString *)value
 NS_SWIFT_NAME(trimUserProp(_:));
 
+// MARK: - Parameter providers
+
+/**
+ * Registers a provider for a dynamic event parameter (e.g., a session ID), replacing any provider previously
+ * registered for the same parameter name. Passing nil removes the provider.
+ *
+ * Fixed parameters belong in setDefaultEventParameters:. Providers are only called for the events they're
+ * registered for, when an event doesn't set the parameter itself, and may be called on a background queue
+ * (so they must be cheap and thread-safe). This includes events logged with logEventWithBuilder:, though
+ * provided values aren't held to the schema's string length limits.
+ *
+ * @param provider Block returning the parameter value for an event (or nil to remove the provider).
+ * @param name Name of the parameter.
+ * @param eventNames Names of the events that get the parameter (nil for all events).
+ * @return False if the maximum of 8 providers is already registered.
+ */
++ (BOOL)setParameterProvider:(nullable AAHParameterProvider)provider forName:(nonnull NSString *)name eventNames:(nullable NSArray<NSString *> *)eventNames
+NS_SWIFT_NAME(setParameterProvider(_:forName:eventNames:));
+
+// MARK: - Sampling and rate limiting
+
+/**
+ * Sets per-event-name sampling and rate limit rules, replacing any previous rules (nil removes all rules).
+ *
+ * Each rule is a dictionary with any of the keys "sample_rate" (share of events to keep, 0.0 to 1.0),
+ * "max_per_minute" (sustained rate allowed), and "burst" (events allowed in a burst). Rules can be loaded
+ * at runtime, e.g. from a Remote Config JSON value.
+ */
++ (void)setThrottleRules:(nullable NSDictionary<NSString *, NSDictionary<NSString *, NSNumber *> *> *)rules;
+
+/**
+ * Returns the number of events dropped by sampling ("sampled_out") and rate limiting ("rate_limited"),
+ * in total and by event name ("events").
+ */
++ (nonnull NSDictionary<NSString *, id> *)throttleStatistics;
+
+// MARK: - Event aggregation
+
+/**
+ * Sets rules for coalescing repetitive events into one summary event per short window, replacing any
+ * previous rules (nil removes all rules).
+ *
+ * Each rule is a dictionary with the keys "key_parameters" (array of parameter names that identify an
+ * aggregate) and "window" (seconds, default 2). Summary events sum numeric parameters, concatenate
+ * "items" arrays (up to 200 products), and add an "aggregate_count" parameter.
+ */
++ (void)setAggregationRules:(nullable NSDictionary<NSString *, NSDictionary *> *)rules;
+
+/**
+ * Logs all held aggregates now instead of waiting for their windows to end.
+ */
++ (void)flushAggregatedEvents;
+
+// MARK: - Event sinks
+
+/**
+ * Registers a destination that receives every event passed to Firebase (e.g., an in-house collector),
+ * after it has been validated and truncated. All sinks share the same immutable event objects.
+ *
+ * Each sink receives its events in order, in batches, on its own serial queue, so a slow sink doesn't
+ * block the caller, Firebase, or other sinks.
+ *
+ * @param sink The sink to add (retained until removed).
+ */
++ (void)addEventSink:(nonnull id<AAHEventSink>)sink;
+
+/**
+ * Unregisters a sink added with addEventSink:. Events already queued for it are still delivered.
+ *
+ * @param sink The sink to remove.
+ */
++ (void)removeEventSink:(nonnull id<AAHEventSink>)sink;
+
+/**
+ * Returns the number of events dropped for sinks that fell too far behind (more than 1000 pending events).
+ */
++ (NSUInteger)droppedSinkEventCount;
+
 // MARK: - Validation/enforcement of Firebase/GA4 rules
 
 /**
@@ -163,6 +407,9 @@ NS_SWIFT_NAME(trimUserProp(_:));
 
 /**
  * Controls whether custom validation error events are sent to Firebase. Default is false.
+ *
+ * Errors are deduplicated and summarized in one error event per 30-second interval, with the most
+ * frequent message, the number of errors, and the most frequent offending names.
  */
 + (void)setSendValidationErrorEvents:(BOOL)enable;
 
@@ -211,6 +458,319 @@ NS_SWIFT_NAME(trimUserProp(_:));
  */
 + (void)sendHitsInBackground;
 
+/**
+ * Returns how the most recent background flush of GA hits ended (typically on the previous launch), including
+ * an estimate of the hits left queued, or nil if none was recorded.
+ */
++ (nullable NSDictionary<NSString *, id> *)lastBackgroundFlushReport;
+
+/**
+ * Sets the policy used to adapt the GA360 (Universal Analytics) dispatch interval to network reachability and type,
+ * Low Power Mode, thermal state, the number of queued hits, and dispatch errors (production builds only).
+ * Passing nil restores the default policy.
+ */
++ (void)setDispatchPolicy:(nullable AAHDispatchPolicy *)policy;
+
+/**
+ * Returns the dispatch scheduler's current interval, conditions, and counters (see setDispatchPolicy:).
+ */
++ (nonnull NSDictionary<NSString *, id> *)dispatchStatistics;
+
+/**
+ * Reports that the app itself just used the network, so queued hits can piggyback on the radio being awake
+ * while on an expensive network (at most once per the dispatch policy's minimum interval).
+ */
++ (void)noteNetworkActivity;
+
+// MARK: - Instrumentation
+
+/**
+ * Enables instrumentation of the helper's own overhead for a share of sessions. Default is 0 (disabled).
+ *
+ * Instrumented sessions emit os_signpost intervals (subsystem "com.adswerve.AAHAnalyticsHelper",
+ * category "Performance") for the timestamp, validation, truncation, and Firebase hand-off stages,
+ * and collect the counters returned by statisticsSnapshot.
+ *
+ * @param sampleRate Share of sessions to instrument, from 0.0 (none) to 1.0 (all).
+ */
++ (void)setInstrumentationSampleRate:(double)sampleRate;
+
+/**
+ * Indicates whether this session was sampled for instrumentation.
+ */
++ (BOOL)isInstrumentationEnabled;
+
+/**
+ * Returns per-stage latency histograms and per-event-name call counts collected by instrumentation.
+ */
++ (nonnull NSDictionary<NSString *, id> *)statisticsSnapshot;
+
+/**
+ * Clears the counters collected by instrumentation.
+ */
++ (void)resetStatistics;
+
+/**
+ * Logs a readable summary of statisticsSnapshot to the console (debug builds only).
+ */
++ (void)dumpStatistics;
+
+// MARK: - Trace recording and replay
+
+/**
+ * Starts recording every call to logEventWithName:parameters:, setUserPropertyString:forName:, setUserID:,
+ * and setDefaultEventParameters: (with its time) to a compact binary trace file. For test builds only.
+ *
+ * @param url File URL of the trace (replaced if it exists).
+ * @return False if the file could not be created.
+ */
++ (BOOL)startTraceRecordingToURL:(nonnull NSURL *)url;
+
+/**
+ * Stops recording calls, and blocks until the trace file is complete.
+ */
++ (void)stopTraceRecording;
+
+/**
+ * Replays a recorded trace against the helper, as currently configured, and returns its throughput, per-call
+ * latency percentiles, dropped events, and memory footprint growth. Blocks until the replayed events have been
+ * passed to Firebase.
+ *
+ * @param url File URL of the trace.
+ * @param speed Replay speed relative to the recording (e.g., 1.0 or 10.0), or 0 to replay as fast as possible.
+ * @return Measurements of the replay, or nil if the trace could not be read.
+ */
++ (nullable NSDictionary<NSString *, NSNumber *> *)replayTraceAtURL:(nonnull NSURL *)url speed:(double)speed;
+
+@end
+
+/**
+ * Immutable event name and parameters, for use with logEvents:sharedTimestamp:.
+ */
+NS_SWIFT_NAME(AnalyticsHelperEvent)
+@interface AAHAnalyticsEvent : NSObject
+
+/** The name of the event. */
+@property (nonatomic, copy, readonly, nonnull) NSString *name;
+
+/** Optional dictionary of event parameters. */
+@property (nonatomic, copy, readonly, nullable) NSDictionary<NSString *, id> *parameters;
+
+/**
+ * Creates an event.
+ *
+ * @param name The name of the event.
+ * @param parameters Optional dictionary of event parameters.
+ */
++ (nonnull instancetype)eventWithName:(nonnull NSString *)name parameters:(nullable NSDictionary<NSString *, id> *)parameters
+NS_SWIFT_NAME(init(name:parameters:));
+
+- (nonnull instancetype)initWithName:(nonnull NSString *)name parameters:(nullable NSDictionary<NSString *, id> *)parameters
+NS_DESIGNATED_INITIALIZER;
+
+- (nonnull instancetype)init NS_UNAVAILABLE;
+
+@end
+
+// MARK: - Event schemas
+
+/** Maximum number of parameters in an event schema (Firebase allows 25, one is reserved for the timestamp). */
+#define kAAHEventSchemaMaxParameters 24
+
+/** Value types for event schema parameters. */
+typedef NS_ENUM(NSInteger, AAHParameterType) {
+    AAHParameterTypeString,
+    AAHParameterTypeInteger,
+    AAHParameterTypeDouble
+} NS_SWIFT_NAME(AnalyticsHelperParameterType);
+
+/** Parameter indexes for the built-in screen_view schema. */
+typedef NS_ENUM(NSUInteger, AAHScreenViewParameter) {
+    AAHScreenViewParameterScreenName,
+    AAHScreenViewParameterScreenClass
+} NS_SWIFT_NAME(AnalyticsHelperScreenViewParameter);
+
+/**
+ * Declares one parameter of an event schema.
+ */
+NS_SWIFT_NAME(AnalyticsHelperParameterSpec)
+@interface AAHParameterSpec : NSObject
+
+/** The name of the parameter. */
+@property (nonatomic, copy, readonly, nonnull) NSString *name;
+
+/** The type of the parameter value. */
+@property (nonatomic, readonly) AAHParameterType type;
+
+/** Maximum length of string values (never more than the Firebase/GA4 maximum). */
+@property (nonatomic, readonly) NSUInteger maxLength;
+
+/**
+ * Creates a parameter declaration.
+ *
+ * @param name The name of the parameter (ideally one of the kAAHAnalyticsHelperParameter constants).
+ * @param type The type of the parameter value.
+ * @param maxLength Maximum length of string values, or 0 for the Firebase/GA4 maximum.
+ */
++ (nonnull instancetype)specWithName:(nonnull NSString *)name type:(AAHParameterType)type maxLength:(NSUInteger)maxLength
+NS_SWIFT_NAME(init(name:type:maxLength:));
+
+- (nonnull instancetype)initWithName:(nonnull NSString *)name type:(AAHParameterType)type maxLength:(NSUInteger)maxLength
+NS_DESIGNATED_INITIALIZER;
+
+- (nonnull instancetype)init NS_UNAVAILABLE;
+
+@end
+
+/**
+ * Declares an event's allowed parameters, their types, and their maximum lengths.
+ *
+ * Register a schema once at startup for each frequently-logged event. Names are validated at
+ * registration, so events logged via an AAHEventBuilder skip name validation entirely. A schema
+ * for screen_view is registered by default (see AAHScreenViewParameter).
+ */
+NS_SWIFT_NAME(AnalyticsHelperEventSchema)
+@interface AAHEventSchema : NSObject
+
+/** The name of the event. */
+@property (nonatomic, copy, readonly, nonnull) NSString *name;
+
+/** The event's parameters, in index order. */
+@property (nonatomic, copy, readonly, nonnull) NSArray<AAHParameterSpec *> *parameters;
+
+/**
+ * Registers (or replaces) the schema for an event. Names are checked against the Firebase/GA4 rules
+ * if validation is enabled.
+ *
+ * @param name The name of the event (ideally one of the kAAHAnalyticsHelperEvent constants).
+ * @param parameters The event's parameters (at most kAAHEventSchemaMaxParameters).
+ * @return The registered schema.
+ */
++ (nonnull instancetype)registerSchemaWithName:(nonnull NSString *)name parameters:(nonnull NSArray<AAHParameterSpec *> *)parameters
+NS_SWIFT_NAME(register(name:parameters:));
+
+/**
+ * Returns the registered schema for an event, if any.
+ *
+ * @param name The name of the event.
+ */
++ (nullable instancetype)schemaForName:(nonnull NSString *)name;
+
+/**
+ * Creates a reusable builder for events of this schema.
+ */
+- (nonnull AAHEventBuilder *)makeBuilder;
+
+- (nonnull instancetype)init NS_UNAVAILABLE;
+
+@end
+
+/**
+ * Typed, reusable parameter builder for an event schema, for use with logEventWithBuilder:.
+ *
+ * Values are stored in fixed-size storage indexed like the schema's parameters, rather than in a
+ * dictionary. Setting a value of the wrong type, or at an index the schema doesn't declare, is
+ * reported as a validation error and ignored.
+ */
+NS_SWIFT_NAME(AnalyticsHelperEventBuilder)
+@interface AAHEventBuilder : NSObject
+
+/** The schema this builder fills in. */
+@property (nonatomic, strong, readonly, nonnull) AAHEventSchema *schema;
+
+- (nonnull instancetype)initWithSchema:(nonnull AAHEventSchema *)schema NS_DESIGNATED_INITIALIZER;
+
+- (nonnull instancetype)init NS_UNAVAILABLE;
+
+/** Sets a string parameter value (nil clears it). */
+- (void)setString:(nullable NSString *)value atIndex:(NSUInteger)index;
+
+/** Sets an integer parameter value. */
+- (void)setInteger:(int64_t)value atIndex:(NSUInteger)index;
+
+/** Sets a floating point parameter value. */
+- (void)setDouble:(double)value atIndex:(NSUInteger)index;
+
+/** Clears all parameter values so the builder can be reused. */
+- (void)reset;
+
+@end
+
+// MARK: - Event sinks
+
+/**
+ * Destination for validated events, in addition to Firebase (see addEventSink:).
+ */
+NS_SWIFT_NAME(AnalyticsHelperEventSink)
+@protocol AAHEventSink <NSObject>
+
+/**
+ * Receives a batch of events, in the order they were logged. Called on the sink's own serial queue.
+ *
+ * @param events Validated and truncated events, with the helper's standard parameters appended.
+ */
+- (void)receiveEvents:(nonnull NSArray<AAHAnalyticsEvent *> *)events;
+
+@optional
+
+/** Maximum number of events per batch. Default is 50. */
+@property (nonatomic, readonly) NSUInteger maxBatchSize;
+
+/** How long to collect events before delivering a batch that isn't full, in seconds. Default is 0 (deliver as soon as possible). */
+@property (nonatomic, readonly) NSTimeInterval maxBatchDelay;
+
+@end
+
+// MARK: - GA dispatch policy
+
+/**
+ * Policy for adapting the GA360 (Universal Analytics) dispatch interval (see setDispatchPolicy:).
+ *
+ * The interval starts at baseInterval, is multiplied under Low Power Mode or a serious thermal state, backs
+ * off exponentially after dispatch errors, and is clamped to [minimumInterval, maximumInterval]. Automatic
+ * dispatch is paused while the network is unreachable. Optionally, hits are dispatched early once flushThreshold
+ * events have been passed to Firebase since the last dispatch.
+ */
+NS_SWIFT_NAME(AnalyticsHelperDispatchPolicy)
+@interface AAHDispatchPolicy : NSObject <NSCopying>
+
+/** Interval under normal conditions, in seconds. Default is 120. */
+@property (nonatomic) NSTimeInterval baseInterval;
+
+/** Shortest allowed interval, in seconds. Default is 30. */
+@property (nonatomic) NSTimeInterval minimumInterval;
+
+/** Longest allowed interval, including backoff, in seconds. Default is 1800. */
+@property (nonatomic) NSTimeInterval maximumInterval;
+
+/**
+ * Number of events passed to Firebase since the last dispatch that triggers an early dispatch (0 disables early
+ * dispatch). Default is 0.
+ *
+ * This counts Firebase events, not GA hits: GAI doesn't expose its queue depth, and only the events GTM turns into
+ * hits are queued, so set this only when most events are sent to GA.
+ */
+@property (nonatomic) NSUInteger flushThreshold;
+
+/** Interval multiplier while Low Power Mode is enabled. Default is 4. */
+@property (nonatomic) double lowPowerMultiplier;
+
+/** Interval multiplier while the thermal state is serious or worse. Default is 4. */
+@property (nonatomic) double thermalMultiplier;
+
+/** Whether automatic dispatch is paused while the thermal state is critical. Default is true. */
+@property (nonatomic) BOOL pausesWhenThermalStateCritical;
+
+/**
+ * Interval multiplier on expensive networks (cellular or personal hotspot). Default is 4.
+ *
+ * Hits held meanwhile are sent as one burst once an inexpensive network (e.g., Wi-Fi) is available.
+ */
+@property (nonatomic) double expensiveNetworkMultiplier;
+
+/** Whether automatic dispatch is paused on constrained networks (Low Data Mode). Default is true. */
+@property (nonatomic) BOOL pausesOnConstrainedNetwork;
+
 @end
 
 #endif // AAHAnalyticsHelper_h
@@ -21,6 +21,8 @@
  * - setThrowOnValidationErrorsInDebug (default: false)
  * - setTruncateStringValues (default: true)
  *
+ * The helper's own overhead can be measured via setInstrumentationSampleRate and statisticsSnapshot.
+ *
  * This code is intended only to illustrate how you might create an analytics helper class.
  * It is not ready for production use as-is.
  *
@@ -35,8 +37,67 @@
 
 #import "AAHAnalyticsHelper.h"
 #import "GAI.h"  // loaded by Google Tag Manager
+#import <os/lock.h>
+#import <os/signpost.h>
+#import <mach/mach.h>
+#import <mach/mach_time.h>
+#import <stdatomic.h>
+#import <sys/mman.h>
+#import <sys/time.h>
+#import <fcntl.h>
+#import <Network/Network.h>
 @import Firebase;
 
+/** Maximum number of parameter providers (see setParameterProvider:forName:eventNames:). */
+#define kMaxParameterProviders 8
+
+/** Private methods shared with the supporting classes at the end of this file. */
+@interface AAHAnalyticsHelper ()
++ (void)handleValidationError:(nonnull NSString*)errorMessage;
++ (BOOL)hasParameterProviders;
++ (NSUInteger)appendProvidedParametersForEventWithName:(nonnull NSString *)eventName names:(__unsafe_unretained NSString *_Nonnull *_Nonnull)names values:(__unsafe_unretained id _Nonnull *_Nonnull)values count:(NSUInteger)count newValues:(NSMutableArray *_Nullable __strong *_Nonnull)newValues;
+@end
+
+/** Private methods of the event schema used by the event builder. */
+@interface AAHEventSchema ()
+- (AAHParameterType)typeAtIndex:(NSUInteger)index;
+- (NSUInteger)maxLengthAtIndex:(NSUInteger)index;
+@end
+
+/** Events held for aggregation (see setAggregationRules:). */
+@interface AAHEventAggregate : NSObject
+@property (nonatomic, copy) NSString *name;
+@property (nonatomic) NSMutableDictionary<NSString *, id> *parameters;
+@property (nonatomic, copy) NSString *timestamp;
+@property (nonatomic) NSUInteger count;
+@end
+
+@implementation AAHEventAggregate
+@end
+
+/** A registered event sink with its own queue and batch of pending events (see addEventSink:). */
+@interface AAHEventSinkRegistration : NSObject
+@property (nonatomic, readonly, nonnull) id<AAHEventSink> sink;
+- (nonnull instancetype)initWithSink:(nonnull id<AAHEventSink>)sink;
+- (void)enqueueEvent:(nonnull AAHAnalyticsEvent *)event;
+@end
+
+/** State of a background flush of GA hits (see sendHitsInBackground). */
+@interface AAHBackgroundFlush : NSObject
+@property (nonatomic) UIBackgroundTaskIdentifier taskId;
+@property (nonatomic) NSUInteger pendingHits;
+@property (nonatomic) NSUInteger dispatchCount;
+@property (nonatomic, getter=isFinished) BOOL finished;
+@end
+
+@implementation AAHBackgroundFlush
+@end
+
+/** Private methods of the event builder used by the helper. */
+@interface AAHEventBuilder ()
+- (nonnull NSDictionary *)makeParametersWithTimestamp:(nonnull NSString *)timestamp validate:(BOOL)validate truncate:(BOOL)truncate;
+@end
+
 @implementation AAHAnalyticsHelper
 
 // MARK: - Initializer
@@ -48,10 +109,26 @@
     if (self == [AAHAnalyticsHelper class]) {
         // Once-only initializion for the class
         
-        // Compile regex patterns for Firebase validation
-        [self makeEventNameRegex];
-        [self makeParameterNameRegex];
-        [self makeUserPropertyNameRegex];
+        // Create table of interned names, which also memoizes Firebase name validation
+        [self makeInternTable];
+        [self updateValidationEnabled];
+        
+        // Create serial queue for asynchronous logging (see setAsynchronousLogging:)
+        [self makeLoggingQueue];
+        
+        // Create signpost log and counters for instrumentation (see setInstrumentationSampleRate:)
+        [self makeInstrumentation];
+        
+        // Refresh cached timezone used for timestamps whenever the system timezone changes, and once
+        // configured, keep the timezone offset user property current
+        [[NSNotificationCenter defaultCenter] addObserverForName:NSSystemTimeZoneDidChangeNotification object:nil queue:nil usingBlock:^(NSNotification * _Nonnull note) {
+            [self invalidateTimestampTimeZone];
+            if (atomic_load_explicit(&_hasRefreshedConfiguration, memory_order_acquire)) {
+                [self performInOrder:^{
+                    [self setUserPropertyStringIfChanged:[self getTimezoneOffset] forName:kAAHAnalyticsHelperUserPropertyTimezoneOffset];
+                }];
+            }
+        }];
         
         // Note: Do not call configure here because this class may be
         // initialized before Firebase itself has been configured
@@ -60,15 +137,16 @@
 
 // MARK: - Configuration
 
-/** Indicates whether this class has been configured. */
-static BOOL _isConfigured = NO;
+/** Ensures configuration runs exactly once, even if several threads make their first call at the same time. */
+static dispatch_once_t _configureOnce;
 
-/** Ensures class is configured before use. */
-+ (BOOL)isConfigured {
-    if (!_isConfigured) {
-        [self configure];
-    }
-    return _isConfigured;
+/**
+ * Ensures class is configured before use.
+ *
+ * After the first call this is a single load (dispatch_once's fast path), so it is cheap enough for every wrapper call.
+ */
++ (void)ensureConfigured {
+    [self configure];
 }
 
 /**
@@ -78,12 +156,94 @@ static BOOL _isConfigured = NO;
  * This method will be called automatically if needed when using the Firebase helper methods below; however,
  * to set initial state as early as possible in the app's startup process, calling this manually immediately after
  * calling `[FIRApp configure]` is recommended.
+ *
+ * Configuration runs once; subsequent calls (including concurrent ones) return without doing anything.
  */
 + (void)configure {
+    __block NSArray<NSDictionary *> *pending = nil;
+    dispatch_once(&_configureOnce, ^{
+        pending = [self performConfiguration];
+    });
+    
+    // replay outside the once block, so a validation exception thrown while replaying (see
+    // setThrowOnValidationErrorsInDebug:) can't leave configuration unfinished
+    if (nil != pending) {
+        [self replayEventJournal:pending];
+    }
+}
+
+/** Private class variables for deferred configuration (see setDeferredConfiguration: below). */
+static BOOL _deferConfiguration = NO;
+static _Atomic(bool) _deferringConfiguration;  // read by AAHShouldQueueCalls on every call
+static _Atomic(bool) _hasRefreshedConfiguration;   // the timezone offset user property has been set
+
+/** User property values set by configure, persisted so unchanged values are not set again on the next launch. */
+static NSString *const kUserPropertyCacheKey = @"com.adswerve.AAHAnalyticsHelper.userProperties";
+static NSMutableDictionary<NSString *, NSString *> *_userPropertyCache = nil;
+static os_unfair_lock _userPropertyCacheLock = OS_UNFAIR_LOCK_INIT;
+
+/**
+ * Controls whether configure defers its work off the app's critical startup path. Default is false.
+ *
+ * When enabled, configure only marks the helper ready. Events and settings are queued in memory (as with
+ * asynchronous logging) while the user property refresh and GA dispatch setup run on a utility QoS queue,
+ * and are then passed to Firebase in order. Must be called before configure (or before the first event).
+ *
+ * @param enable True to defer configuration.
+ */
++ (void)setDeferredConfiguration:(BOOL)enable {
+    _deferConfiguration = enable;
+}
+
+/**
+ * Sets initial state and refreshes user properties (see configure above), either immediately or on the
+ * logging queue if configuration is deferred. Runs exactly once.
+ *
+ * @return Events left pending in the journal by the previous launch, to replay once configuration has finished.
+ */
++ (nullable NSArray<NSDictionary *> *)performConfiguration {
+    // resolve validation state once, rather than on every call
+    [self updateValidationEnabled];
+    
+    if (_deferConfiguration) {
+        // queue calls in memory until the logging queue has finished the setup below
+        atomic_store_explicit(&_deferringConfiguration, true, memory_order_release);
+        dispatch_async(_loggingQueue, ^{
+            [self refreshConfiguration];
+            
+            // flush calls queued during startup, in order, before clearing the flag (so no call can reach
+            // Firebase directly ahead of them), then flush calls that were queued while the flag was cleared
+            [self drainLoggingBuffer];
+            atomic_store_explicit(&_deferringConfiguration, false, memory_order_release);
+            [self drainLoggingBuffer];
+        });
+    } else {
+        [self refreshConfiguration];
+    }
+    
+    // events that Firebase had not accepted when the previous launch ended (see setEventJournalEnabled:)
+    return _journalEnabled ? [self openEventJournal] : nil;
+}
+
+/**
+ * Refreshes user properties that may have changed since the previous launch, and sets up GA dispatch.
+ */
++ (void)refreshConfiguration {
 
     // refresh user properties that may have changed since last launch
-    [FIRAnalytics setUserPropertyString:[self getTimezoneOffset] forName:kAAHAnalyticsHelperUserPropertyTimezoneOffset];     // example
-    [FIRAnalytics setUserPropertyString:[FIRAnalytics appInstanceID] forName:kAAHAnalyticsHelperUserPropertyAppInstanceID];  // example
+    // (unchanged values are skipped, see setUserPropertyStringIfChanged:forName:)
+    [self setUserPropertyStringIfChanged:[self getTimezoneOffset] forName:kAAHAnalyticsHelperUserPropertyTimezoneOffset];     // example
+    
+    // after launch, keep the timezone offset current when the system timezone changes (see initialize)
+    atomic_store_explicit(&_hasRefreshedConfiguration, true, memory_order_release);
+    
+    // fetch the app instance ID off the startup path, since Firebase may block until its own startup has finished
+    dispatch_async(dispatch_get_global_queue(QOS_CLASS_UTILITY, 0), ^{
+        NSString *appInstanceID = [FIRAnalytics appInstanceID];
+        [self performInOrder:^{
+            [self setUserPropertyStringIfChanged:appInstanceID forName:kAAHAnalyticsHelperUserPropertyAppInstanceID];  // example
+        }];
+    });
     
     // set an "environment" user property to allow GTM to send hits to the desired GA360 property (optional)
     // also allows test data to be filtered out in GA4/Firebase/BigQuery
@@ -95,15 +255,66 @@ static BOOL _isConfigured = NO;
     if([self isDebugBuild]) {
         // default implementation determines environment based on build type, but
         // the criteria can be made more sophisticated as needed
-        [FIRAnalytics setUserPropertyString:@"test" forName:kAAHAnalyticsHelperUserPropertyEnvironment];
+        [self setUserPropertyStringIfChanged:@"test" forName:kAAHAnalyticsHelperUserPropertyEnvironment];
     } else {
-        [FIRAnalytics setUserPropertyString:@"production" forName:kAAHAnalyticsHelperUserPropertyEnvironment];
+        [self setUserPropertyStringIfChanged:@"production" forName:kAAHAnalyticsHelperUserPropertyEnvironment];
     }
     
     // set GA dispatch interval (only applicable if using GTM to send data to Universal Analytics)
     [self setDispatchInterval];
-    
-    _isConfigured = YES;
+}
+
+/**
+ * Passes a user property to Firebase unless it was already set to the same value (on this or a previous launch).
+ *
+ * Firebase persists user properties across launches, so an unchanged value doesn't need to be set again.
+ *
+ * @param value The value of the user property.
+ * @param name The name of the user property to set.
+ */
++ (void)setUserPropertyStringIfChanged:(nullable NSString *)value forName:(nonnull NSString *)name {
+    os_unfair_lock_lock(&_userPropertyCacheLock);
+    if (nil == _userPropertyCache) {
+        NSDictionary *saved = [[NSUserDefaults standardUserDefaults] dictionaryForKey:kUserPropertyCacheKey];
+        _userPropertyCache = (nil == saved) ? [[NSMutableDictionary alloc] init] : [saved mutableCopy];
+    }
+    BOOL isUnchanged = (nil != value) && [_userPropertyCache[name] isEqualToString:value];
+    os_unfair_lock_unlock(&_userPropertyCacheLock);
+    if (isUnchanged) {
+        return;
+    }
+    [FIRAnalytics setUserPropertyString:value forName:name];
+    [self updateUserPropertyCache:value forName:name onlyIfCached:NO];
+}
+
+/**
+ * Records a user property value so an unchanged value can be skipped on the next launch.
+ *
+ * @param value The value of the user property (nil clears it).
+ * @param name The name of the user property.
+ * @param onlyIfCached If true, only updates properties that are already cached (i.e., those set by configure).
+ */
++ (void)updateUserPropertyCache:(nullable NSString *)value forName:(nonnull NSString *)name onlyIfCached:(BOOL)onlyIfCached {
+    os_unfair_lock_lock(&_userPropertyCacheLock);
+    NSDictionary *snapshot = nil;
+    if (nil != _userPropertyCache && (!onlyIfCached || nil != _userPropertyCache[name])) {
+        _userPropertyCache[name] = value;
+        snapshot = [_userPropertyCache copy];
+    }
+    os_unfair_lock_unlock(&_userPropertyCacheLock);
+    if (nil != snapshot) {
+        [[NSUserDefaults standardUserDefaults] setObject:snapshot forKey:kUserPropertyCacheKey];
+    }
+}
+
+/**
+ * Forgets cached user property values (e.g., after Firebase analytics data is reset).
+ */
++ (void)clearUserPropertyCache {
+    os_unfair_lock_lock(&_userPropertyCacheLock);
+    [_userPropertyCache removeAllObjects];
+    os_unfair_lock_unlock(&_userPropertyCacheLock);
+    [[NSUserDefaults standardUserDefaults] removeObjectForKey:kUserPropertyCacheKey];
 }
 
 // MARK: - Firebase helpers
@@ -117,22 +328,355 @@ static BOOL _isConfigured = NO;
  */
 + (void)logEventWithName:(nonnull NSString *)name parameters:(nullable NSDictionary<NSString *, id> *)parameters
 NS_SWIFT_NAME(logEvent(_:parameters:)) {
+    if (AAHIsRecordingTrace()) {
+        AAHTraceRecordCall(AAHTraceCallLogEvent, name, nil, parameters);
+    }
     
-    if ([self isConfigured]) {
-        // append additional parameters before logging the event (optional)
-        // this could be done on every event, or just on certain events
-        NSMutableDictionary *newParams = (nil == parameters) ? [[NSMutableDictionary alloc] init] : [parameters mutableCopy];
-        [newParams setValue:[self getTimestamp] forKey:kAAHAnalyticsHelperParameterTimestamp]; // example: append timestamp parameter
-        
-        // validate event name and parameters before passing event to Firebase
-        [self validateEventWithName:name parameters:newParams];
-        
-        // log updated event to Firebase Analytics
-        [FIRAnalytics logEventWithName:name parameters: _truncateStringValues ? [self truncateParams:newParams] : newParams];
+    // sampling and rate limiting come first, so dropped events cost almost nothing
+    if (AAHShouldDropEvent(name)) {
+        return;
+    }
+    // coalesce repetitive events into one summary event per window (see setAggregationRules:)
+    if (AAHIsAggregatedEvent(name) && [self aggregateEventWithName:name parameters:parameters]) {
+        return;
+    }
+    [self ingestEventWithName:name parameters:parameters timestamp:nil];
+}
+
+/**
+ * Captures the event's timestamp (unless provided), journals it, and validates and passes it to Firebase,
+ * either immediately or via the logging queue.
+ *
+ * @param name The name of the event.
+ * @param parameters Dictionary of event parameters (optional).
+ * @param eventTimestamp Timestamp captured earlier (e.g., for an aggregated event), or nil to capture it now.
+ */
++ (void)ingestEventWithName:(nonnull NSString *)name parameters:(nullable NSDictionary<NSString *, id> *)parameters timestamp:(nullable NSString *)eventTimestamp {
+    AAHStageTimer callTimer = AAHStageBegin(AAHStageCall);
+    [self ensureConfigured];
+    
+    // capture timestamp at the time of the call, even if the event is processed later
+    AAHStageTimer timestampTimer = AAHStageBegin(AAHStageTimestamp);
+    NSString *timestamp = eventTimestamp ?: [self getTimestamp];
+    AAHStageEnd(AAHStageTimestamp, timestampTimer);
+    uint64_t journalSequence = AAHJournalAppend(name, parameters, timestamp);
+    if (AAHShouldQueueCalls()) {
+        // snapshot inputs so later changes by the caller don't affect the queued event
+        [self enqueueEventWithName:[name copy] parameters:[parameters copy] timestamp:timestamp journalSequence:journalSequence block:nil];
+    } else {
+        [self processEventWithName:name parameters:parameters timestamp:timestamp journalSequence:journalSequence];
+    }
+    AAHCountEvent(name, AAHStageEnd(AAHStageCall, callTimer));
+}
+
+/**
+ * Logs a batch of events, validating and truncating the whole batch in one pass before passing the
+ * events to Firebase in order.
+ *
+ * Configuration and validation state are only evaluated once for the batch, which makes this more
+ * efficient than calling logEventWithName:parameters: for each event (e.g., for a burst of impressions).
+ *
+ * @param events Events to log, in order.
+ * @param sharedTimestamp If true, all events in the batch get the same timestamp parameter.
+ */
++ (void)logEvents:(nonnull NSArray<AAHAnalyticsEvent *> *)events sharedTimestamp:(BOOL)sharedTimestamp
+NS_SWIFT_NAME(logEvents(_:sharedTimestamp:)) {
+    if (_hasThrottleRules) {
+        // sampling and rate limiting come first (see logEventWithName:parameters:)
+        events = [events objectsAtIndexes:[events indexesOfObjectsPassingTest:^BOOL(AAHAnalyticsEvent *event, NSUInteger i, BOOL *stop) {
+            return !AAHShouldDropEvent(event.name);
+        }]];
+    }
+    if (0 == events.count) {
+        return;
+    }
+    AAHStageTimer callTimer = AAHStageBegin(AAHStageCall);
+    [self ensureConfigured];
+    
+    // capture timestamps at the time of the call, even if the events are processed later
+    AAHStageTimer timestampTimer = AAHStageBegin(AAHStageTimestamp);
+    NSMutableArray<NSString *> *timestamps = [NSMutableArray arrayWithCapacity:sharedTimestamp ? 1 : events.count];
+    [timestamps addObject:[self getTimestamp]];
+    for (NSUInteger i = 1; !sharedTimestamp && i < events.count; i++) {
+        [timestamps addObject:[self getTimestamp]];
+    }
+    AAHStageEnd(AAHStageTimestamp, timestampTimer);
+    NSArray<AAHAnalyticsEvent *> *batch = [events copy];
+    NSMutableData *journalSequences = nil;
+    if (NULL != _journalRecords) {
+        journalSequences = [NSMutableData dataWithLength:batch.count * sizeof(uint64_t)];
+        uint64_t *sequences = journalSequences.mutableBytes;
+        [batch enumerateObjectsUsingBlock:^(AAHAnalyticsEvent *event, NSUInteger i, BOOL *stop) {
+            sequences[i] = AAHJournalAppend(event.name, event.parameters, timestamps[sharedTimestamp ? 0 : i]);
+        }];
+    }
+    [self performInOrder:^{
+        [self processEvents:batch timestamps:timestamps journalSequences:journalSequences];
+    }];
+    // attribute the batch's calling-thread time evenly to its events
+    uint64_t nanoseconds = AAHStageEnd(AAHStageCall, callTimer) / events.count;
+    for (AAHAnalyticsEvent *event in events) {
+        AAHCountEvent(event.name, nanoseconds);
+    }
+}
+
+/**
+ * Logs an event built from a registered event schema (see AAHEventSchema).
+ *
+ * Event and parameter names were checked when the schema was registered, so only the bounded checks
+ * on string value lengths remain. The builder is not retained and may be reset and reused immediately.
+ *
+ * @param builder Builder holding the event's parameter values.
+ */
++ (void)logEventWithBuilder:(nonnull AAHEventBuilder *)builder
+NS_SWIFT_NAME(logEvent(_:)) {
+    NSString *name = builder.schema.name;
+    if (AAHShouldDropEvent(name)) {
+        return;
+    }
+    AAHStageTimer callTimer = AAHStageBegin(AAHStageCall);
+    AAHStageTimer timestampTimer = AAHStageBegin(AAHStageTimestamp);
+    NSString *timestamp = [self getTimestamp];
+    AAHStageEnd(AAHStageTimestamp, timestampTimer);
+    [self ensureConfigured];
+    NSDictionary *newParams = [builder makeParametersWithTimestamp:timestamp validate:AAHIsValidationEnabled() truncate:_truncateStringValues];
+    uint64_t journalSequence = AAHJournalAppend(name, newParams, timestamp);
+    [self performInOrder:^{
+        AAHStageTimer firebaseTimer = AAHStageBegin(AAHStageFirebase);
+        [FIRAnalytics logEventWithName:name parameters:newParams];
+        AAHStageEnd(AAHStageFirebase, firebaseTimer);
+        AAHJournalCheckpoint(journalSequence);
+        AAHNoteFirebaseEvent();
+        AAHFanOutEvent(name, newParams);
+    }];
+    AAHCountEvent(name, AAHStageEnd(AAHStageCall, callTimer));
+}
+
+/**
+ * Appends standard parameters to the event, validates it, and passes it to Firebase.
+ *
+ * Runs on the calling thread, or on the logging queue if asynchronous logging is enabled.
+ *
+ * @param name The name of the event.
+ * @param parameters Dictionary of event parameters (optional).
+ * @param timestamp Timestamp captured when the event was logged.
+ * @param journalSequence Journal record to checkpoint once Firebase has accepted the event (0 if not journaled).
+ */
++ (void)processEventWithName:(nonnull NSString *)name parameters:(nullable NSDictionary<NSString *, id> *)parameters timestamp:(nonnull NSString *)timestamp journalSequence:(uint64_t)journalSequence {
+    NSDictionary *newParams = [self prepareEventWithName:name parameters:parameters timestamp:timestamp validate:AAHIsValidationEnabled()];
+    
+    // log updated event to Firebase Analytics
+    AAHStageTimer firebaseTimer = AAHStageBegin(AAHStageFirebase);
+    [FIRAnalytics logEventWithName:name parameters:newParams];
+    AAHStageEnd(AAHStageFirebase, firebaseTimer);
+    AAHJournalCheckpoint(journalSequence);
+    AAHNoteFirebaseEvent();
+    AAHFanOutEvent(name, newParams);
+}
+
+/** Smallest batch whose events are prepared in parallel, and the number of events each worker prepares at a time. */
+static const NSUInteger kParallelBatchMinCount = 128;
+static const NSUInteger kParallelBatchChunkSize = 32;
+
+/**
+ * Appends standard parameters to each event in the batch, validates them, and passes them to Firebase in order.
+ *
+ * @param events Events to log, in order.
+ * @param timestamps Timestamps captured when the events were logged (either one per event, or one for the whole batch).
+ * @param journalSequences Journal records (uint64_t per event) to checkpoint once Firebase has accepted the events (optional).
+ */
++ (void)processEvents:(nonnull NSArray<AAHAnalyticsEvent *> *)events timestamps:(nonnull NSArray<NSString *> *)timestamps journalSequences:(nullable NSData *)journalSequences {
+    const uint64_t *sequences = journalSequences.bytes;
+    NSUInteger count = events.count;
+    // evaluate validation state once for the whole batch
+    BOOL validate = AAHIsValidationEnabled();
+    BOOL isSharedTimestamp = timestamps.count < count;
+    
+    // prepare events independently of each other, split across cores for large batches
+    // (exceptions can't be thrown from dispatch_apply's worker threads, so those batches are prepared serially)
+    const void **prepared = calloc(count, sizeof(void *));
+    if (NULL == prepared) {
+        // no room to hold the prepared batch, so prepare and log the events one at a time
+        for (NSUInteger i = 0; i < count; i++) {
+            @autoreleasepool {
+                [self processEventWithName:events[i].name parameters:events[i].parameters timestamp:isSharedTimestamp ? timestamps[0] : timestamps[i] journalSequence:(NULL == sequences) ? 0 : sequences[i]];
+            }
+        }
+        return;
+    }
+    BOOL isParallel = count >= kParallelBatchMinCount && !(_throwOnValidationErrorsInDebug && [self isDebugBuild]);
+    size_t chunkCount = isParallel ? (count + kParallelBatchChunkSize - 1) / kParallelBatchChunkSize : 1;
+    size_t chunkSize = isParallel ? kParallelBatchChunkSize : count;
+    void (^prepareChunk)(size_t) = ^(size_t chunk) {
+        for (NSUInteger i = chunk * chunkSize; i < MIN((chunk + 1) * chunkSize, count); i++) {
+            @autoreleasepool {
+                AAHAnalyticsEvent *event = events[i];
+                NSString *timestamp = isSharedTimestamp ? timestamps[0] : timestamps[i];
+                prepared[i] = CFBridgingRetain([self prepareEventWithName:event.name parameters:event.parameters timestamp:timestamp validate:validate]);
+            }
+        }
+    };
+    if (isParallel) {
+        dispatch_apply(chunkCount, DISPATCH_APPLY_AUTO, prepareChunk);
     } else {
-        // pass directly to Firebase
-        [FIRAnalytics logEventWithName:name parameters:parameters];
+        prepareChunk(0);
+    }
+    
+    // log updated events to Firebase Analytics, in order
+    for (NSUInteger i = 0; i < count; i++) {
+        NSDictionary *newParams = CFBridgingRelease(prepared[i]);
+        AAHStageTimer firebaseTimer = AAHStageBegin(AAHStageFirebase);
+        [FIRAnalytics logEventWithName:events[i].name parameters:newParams];
+        AAHStageEnd(AAHStageFirebase, firebaseTimer);
+        AAHNoteFirebaseEvent();
+        if (NULL != sequences) {
+            AAHJournalCheckpoint(sequences[i]);
+        }
+        AAHFanOutEvent(events[i].name, newParams);
+    }
+    free(prepared);
+}
+
+/**
+ * Logs an event with parameters from a parameter list (see AAHParameterList), so the only dictionary
+ * built is the one passed to Firebase.
+ *
+ * The list is processed on the calling thread. If the event must be kept beyond the call (asynchronous
+ * logging, the event journal, or aggregation), the list is converted into a dictionary up front instead.
+ *
+ * @param name The name of the event.
+ * @param parameterList Optional list of event parameters.
+ */
++ (void)logEventWithName:(nonnull NSString *)name parameterList:(nullable const AAHParameterList *)parameterList {
+    if (AAHShouldDropEvent(name)) {
+        return;
+    }
+    NSUInteger count = (NULL == parameterList) ? 0 : MIN(parameterList->count, (NSUInteger)AAH_PARAMETER_LIST_CAPACITY);
+    [self ensureConfigured];
+    if (AAHShouldQueueCalls() || NULL != _journalRecords || AAHIsAggregatedEvent(name)) {
+        NSDictionary *parameters = (0 == count) ? nil : [NSDictionary dictionaryWithObjects:parameterList->values forKeys:parameterList->names count:count];
+        if (!AAHIsAggregatedEvent(name) || ![self aggregateEventWithName:name parameters:parameters]) {
+            [self ingestEventWithName:name parameters:parameters timestamp:nil];
+        }
+        return;
+    }
+    AAHStageTimer callTimer = AAHStageBegin(AAHStageCall);
+    AAHStageTimer timestampTimer = AAHStageBegin(AAHStageTimestamp);
+    NSString *timestamp = [self getTimestamp];
+    AAHStageEnd(AAHStageTimestamp, timestampTimer);
+    
+    // work on a copy with room for the standard and provided parameters (the caller's list is left unchanged)
+    __unsafe_unretained NSString *names[AAH_PARAMETER_LIST_CAPACITY + 1 + kMaxParameterProviders];
+    __unsafe_unretained id values[AAH_PARAMETER_LIST_CAPACITY + 1 + kMaxParameterProviders];
+    if (count > 0) {
+        memcpy(names, parameterList->names, count * sizeof(names[0]));
+        memcpy(values, parameterList->values, count * sizeof(values[0]));
+    }
+    NSDictionary *newParams = [self prepareEventWithName:name names:names values:values count:count timestamp:timestamp validate:AAHIsValidationEnabled()];
+    
+    // log updated event to Firebase Analytics
+    AAHStageTimer firebaseTimer = AAHStageBegin(AAHStageFirebase);
+    [FIRAnalytics logEventWithName:name parameters:newParams];
+    AAHStageEnd(AAHStageFirebase, firebaseTimer);
+    AAHNoteFirebaseEvent();
+    AAHFanOutEvent(name, newParams);
+    AAHCountEvent(name, AAHStageEnd(AAHStageCall, callTimer));
+}
+
+/** C entry point for logEventWithName:parameterList: (see AAHAnalyticsHelper.h). */
+void AAHLogEvent(NSString *name, const AAHParameterList *parameters) {
+    [AAHAnalyticsHelper logEventWithName:name parameterList:parameters];
+}
+
+/**
+ * Appends standard parameters to the event's parameters, then validates and truncates them as configured.
+ *
+ * The parameters are gathered into a parameter list on the stack (on the heap for events with more than
+ * AAH_PARAMETER_LIST_CAPACITY parameters), so the dictionary returned is the only one built (see
+ * prepareEventWithName:names:values:count:timestamp:validate:).
+ *
+ * @param name The name of the event.
+ * @param parameters Dictionary of event parameters (optional).
+ * @param timestamp Timestamp captured when the event was logged.
+ * @param validate Whether to check the event against the Firebase/GA4 rules.
+ * @return Parameters to pass to Firebase.
+ */
++ (nonnull NSDictionary *)prepareEventWithName:(nonnull NSString *)name parameters:(nullable NSDictionary<NSString *, id> *)parameters timestamp:(nonnull NSString *)timestamp validate:(BOOL)validate {
+    // room for the timestamp and provided parameters, on the stack unless the event has more parameters than
+    // a valid one could (the caller's count is unbounded, and background threads have small stacks)
+    NSUInteger count = parameters.count;
+    NSUInteger capacity = count + 1 + kMaxParameterProviders;
+    __unsafe_unretained NSString *stackNames[AAH_PARAMETER_LIST_CAPACITY + 1 + kMaxParameterProviders];
+    __unsafe_unretained id stackValues[AAH_PARAMETER_LIST_CAPACITY + 1 + kMaxParameterProviders];
+    __unsafe_unretained NSString **names = stackNames;
+    __unsafe_unretained id *values = stackValues;
+    void *heapBuffer = NULL;
+    if (count > AAH_PARAMETER_LIST_CAPACITY) {
+        heapBuffer = malloc(2 * capacity * sizeof(id));
+        if (NULL == heapBuffer) {
+            return parameters;
+        }
+        names = (__unsafe_unretained NSString **)heapBuffer;
+        values = (__unsafe_unretained id *)heapBuffer + capacity;
+    }
+    [parameters getObjects:values andKeys:names count:count];
+    NSDictionary *newParams = [self prepareEventWithName:name names:names values:values count:count timestamp:timestamp validate:validate];
+    free(heapBuffer);
+    return newParams;
+}
+
+/**
+ * Appends standard parameters to a parameter list, validates and truncates it as configured, and builds the
+ * dictionary passed to Firebase from it.
+ *
+ * @param name The name of the event.
+ * @param names Parameter names (with room for 1 + kMaxParameterProviders more parameters).
+ * @param values Parameter values (with room for 1 + kMaxParameterProviders more parameters).
+ * @param count Number of parameters.
+ * @param timestamp Timestamp captured when the event was logged.
+ * @param validate Whether to check the event against the Firebase/GA4 rules.
+ * @return Parameters to pass to Firebase.
+ */
++ (nonnull NSDictionary *)prepareEventWithName:(nonnull NSString *)name names:(__unsafe_unretained NSString *_Nonnull *_Nonnull)names values:(__unsafe_unretained id _Nonnull *_Nonnull)values count:(NSUInteger)count timestamp:(nonnull NSString *)timestamp validate:(BOOL)validate {
+    // append additional parameters before logging the event (optional)
+    // this could be done on every event, or just on certain events
+    NSUInteger timestampIndex = 0;
+    while (timestampIndex < count && ![names[timestampIndex] isEqual:kAAHAnalyticsHelperParameterTimestamp]) {
+        timestampIndex++;
+    }
+    names[timestampIndex] = kAAHAnalyticsHelperParameterTimestamp; // example: append timestamp parameter
+    values[timestampIndex] = timestamp;
+    count = MAX(count, timestampIndex + 1);
+    
+    // keeps values created below (provided or truncated) alive until the dictionary is built
+    NSMutableArray *newValues = nil;
+    if (_hasParameterProviders) {
+        count = [self appendProvidedParametersForEventWithName:name names:names values:values count:count newValues:&newValues];
     }
+    
+    // validate event name and parameters before passing event to Firebase
+    if (validate) {
+        AAHStageTimer validationTimer = AAHStageBegin(AAHStageValidation);
+        [self checkEventWithName:name names:names values:values count:count];
+        AAHStageEnd(AAHStageValidation, validationTimer);
+    }
+    
+    // truncate string values in the list
+    if (_truncateStringValues) {
+        AAHStageTimer truncationTimer = AAHStageBegin(AAHStageTruncation);
+        for (NSUInteger i = 0; i < count; i++) {
+            id newValue = [self truncatedParamValue:values[i] forName:names[i]];
+            if (nil != newValue) {
+                if (nil == newValues) {
+                    newValues = [NSMutableArray array];
+                }
+                [newValues addObject:newValue];
+                values[i] = newValue;
+            }
+        }
+        AAHStageEnd(AAHStageTruncation, truncationTimer);
+    }
+    return [NSDictionary dictionaryWithObjects:values forKeys:names count:count];
 }
 
 /**
@@ -142,13 +686,17 @@ NS_SWIFT_NAME(logEvent(_:parameters:)) {
  * @param parameters Dictionary of event parameters (or nil to clear them).
  */
 + (void)setDefaultEventParameters:(nullable NSDictionary<NSString *,id> *)parameters {
-    if ([self isConfigured]) {
-        [self validateParameters:parameters source:@"default event parameters"];
-        [FIRAnalytics setDefaultEventParameters:_truncateStringValues ? [self truncateParams:parameters] : parameters];
-    } else {
-        // pass directly to Firebase
-        [FIRAnalytics setDefaultEventParameters:parameters];
+    if (AAHIsRecordingTrace()) {
+        AAHTraceRecordCall(AAHTraceCallSetDefaultEventParameters, nil, nil, parameters);
     }
+    [self ensureConfigured];
+    NSDictionary *defaultParams = [parameters copy];
+    [self performInOrder:^{
+        if (AAHIsValidationEnabled() && nil != defaultParams) {
+            [self checkParameters:defaultParams source:@"default event parameters"];
+        }
+        [FIRAnalytics setDefaultEventParameters:_truncateStringValues ? [self truncateParams:defaultParams] : defaultParams];
+    }];
 }
 
 /**
@@ -160,13 +708,22 @@ NS_SWIFT_NAME(logEvent(_:parameters:)) {
  */
 + (void)setUserPropertyString:(nullable NSString *)value forName:(nonnull NSString *)name
 NS_SWIFT_NAME(setUserProperty(_:forName:)) {
-    if([self isConfigured]) {
-        [self validateUserProperty:value forName:name];
-        [FIRAnalytics setUserPropertyString:(_truncateStringValues ? [self truncateUserProp:value] : value) forName:name];
-    } else {
-        // pass directly to Firebase
-        [FIRAnalytics setUserPropertyString:value forName:name];
+    if (AAHIsRecordingTrace()) {
+        AAHTraceRecordCall(AAHTraceCallSetUserProperty, name, value, nil);
     }
+    [self ensureConfigured];
+    NSString *propertyName = [name copy];
+    NSString *propertyValue = [value copy];
+    [self performInOrder:^{
+        if (AAHIsValidationEnabled()) {
+            [self checkUserProperty:propertyValue forName:propertyName];
+        }
+        NSString *newValue = _truncateStringValues ? [self truncateUserProp:propertyValue] : propertyValue;
+        [FIRAnalytics setUserPropertyString:newValue forName:propertyName];
+        
+        // keep values cached by configure current (see setUserPropertyStringIfChanged:forName:)
+        [self updateUserPropertyCache:newValue forName:propertyName onlyIfCached:YES];
+    }];
 }
 
 /**
@@ -178,13 +735,17 @@ NS_SWIFT_NAME(setUserProperty(_:forName:)) {
  * @param userID Value to set as the Firebase User ID (or nil to clear it).
  */
 + (void)setUserID:(nullable NSString*)userID {
-    if([self isConfigured]) {
-        [self validateUserID:userID];
-        [FIRAnalytics setUserID:userID];
-    } else {
-        // pass directly to Firebase
-        [FIRAnalytics setUserID:userID];
+    if (AAHIsRecordingTrace()) {
+        AAHTraceRecordCall(AAHTraceCallSetUserID, nil, userID, nil);
     }
+    [self ensureConfigured];
+    NSString *newUserID = [userID copy];
+    [self performInOrder:^{
+        if (AAHIsValidationEnabled() && nil != newUserID) {
+            [self checkUserID:newUserID];
+        }
+        [FIRAnalytics setUserID:newUserID];
+    }];
 }
 
 /**
@@ -196,7 +757,9 @@ NS_SWIFT_NAME(setUserProperty(_:forName:)) {
  * @param analyticsCollectionEnabled A flag that enables or disables Analytics collection.
  */
 + (void)setAnalyticsCollectionEnabled:(BOOL)analyticsCollectionEnabled {
-    [FIRAnalytics setAnalyticsCollectionEnabled:analyticsCollectionEnabled];
+    [self performInOrder:^{
+        [FIRAnalytics setAnalyticsCollectionEnabled:analyticsCollectionEnabled];
+    }];
 }
 
 /**
@@ -206,7 +769,12 @@ NS_SWIFT_NAME(setUserProperty(_:forName:)) {
  * FIRAnalyticsConfiguration values will be reset to the default values.
  */
 + (void)resetAnalyticsData {
-    [FIRAnalytics resetAnalyticsData];
+    [self performInOrder:^{
+        [FIRAnalytics resetAnalyticsData];
+        
+        // user properties were cleared, so they must be set again on the next launch
+        [self clearUserPropertyCache];
+    }];
 }
 
 /**
@@ -244,419 +812,3638 @@ NS_SWIFT_NAME(setUserProperty(_:forName:)) {
  * public truncateParam: method on just those string values that might exceed the max, but
  * this method can ensure overall compliance if desired.
  *
+ * The dictionary is only copied if a value actually needs to be shortened. String values in the
+ * Ecommerce "items" array of products are truncated as well.
+ *
  * @param parameters Parameter dictionary to evaluate.
- * @return Dictionary with string values shortened (if needed).
+ * @return Dictionary with string values shortened (or the original dictionary if nothing needed shortening).
  */
 + (nullable NSDictionary *)truncateParams:(nullable NSDictionary *)parameters {
-    if (nil == parameters) {
-        return parameters;
-    } else {
-        NSMutableDictionary *newParams = [NSMutableDictionary dictionary];
-        [newParams setDictionary:parameters];
-        for(id name in newParams.allKeys) {
-            id value = [newParams valueForKey:name];
-            if ([value isKindOfClass:[NSString class]] && [value length] > kValidationParameterValueMaxLength) {
-                [newParams setValue:[value substringToIndex:kValidationParameterValueMaxLength] forKey:name];
+    __block NSMutableDictionary *newParams = nil;
+    [parameters enumerateKeysAndObjectsUsingBlock:^(id name, id value, BOOL *stop) {
+        id newValue = [self truncatedParamValue:value forName:name];
+        if (nil != newValue) {
+            if (nil == newParams) {
+                // copy on first write
+                newParams = [parameters mutableCopy];
             }
+            newParams[name] = newValue;
         }
-        return newParams;
+    }];
+    return (nil == newParams) ? parameters : newParams;
+}
+
+/**
+ * Truncates a single parameter value to maximum supported length.
+ *
+ * @param value Parameter value to evaluate.
+ * @param name Name of the parameter.
+ * @return The shortened value, or nil if the value doesn't need shortening.
+ */
++ (nullable id)truncatedParamValue:(nonnull id)value forName:(nonnull id)name {
+    if ([value isKindOfClass:[NSString class]]) {
+        return ([value length] > kValidationParameterValueMaxLength) ? [value substringToIndex:kValidationParameterValueMaxLength] : nil;
+    }
+    if ([value isKindOfClass:[NSArray class]] && [name isEqual:@"items"]) {
+        // special handling required for Ecommerce "items" parameter, which contains an array of products
+        __block NSMutableArray *newItems = nil;
+        [(NSArray *)value enumerateObjectsUsingBlock:^(id product, NSUInteger i, BOOL *stop) {
+            if ([product isKindOfClass:[NSDictionary class]]) {
+                NSDictionary *newProduct = [self truncateParams:product];
+                if (newProduct != product) {
+                    if (nil == newItems) {
+                        // copy on first write
+                        newItems = [value mutableCopy];
+                    }
+                    newItems[i] = newProduct;
+                }
+            }
+        }];
+        return newItems;
     }
+    return nil;
 }
 
-// MARK: - Validation/enforcement of Firebase/GA4 rules
+// MARK: - Name interning
 
-/** Firebase rules as defined at https://firebase.google.com/docs/reference/ios/firebaseanalytics/api/reference/Classes/FIRAnalytics */
-static const int kValidationEventMaxParameters = 25;
-static const int kValidationEventNameMaxLength = 40;
-static const int kValidationParameterNameMaxLength = 40;
-static const int kValidationParameterValueMaxLength = 100;
-static const int kValidationUserPropertyNameMaxLength = 24;
-static const int kValidationUserPropertyValueMaxLength = 36;
-static const int kValidationUserIdValueMaxLength = 256;
-static NSString *const kValidationEventNamePattern = @"^(?!ga_|google_|firebase_)[A-Za-z]{1}[A-Za-z0-9_]{0,%d}$";
-static NSString *const kValidationParameterNamePattern = @"^(?!ga_|google_|firebase_)[A-Za-z]{1}[A-Za-z0-9_]{0,%d}$";
-static NSString *const kValidationUserPropertyNamePattern = @"^(?!ga_|google_|firebase_)[A-Za-z]{1}[A-Za-z0-9_]{0,%d}$";
+/** Number of slots in the intern table (must be a power of 2, and at least twice kInternMaxNames). */
+#define kInternTableCapacity 1024
+
+/** Maximum number of distinct names interned (names beyond this are not interned, and are validated every time). */
+#define kInternMaxNames 512
+
+/** Small integer ID of an interned name (IDs start at 1). */
+typedef uint16_t AAHNameID;
+static const AAHNameID kAAHNameIDNone = 0;
+
+/** Kinds of names, each validated against its own rules (see AAHCheckName). */
+typedef NS_ENUM(NSUInteger, AAHNameKind) {
+    AAHNameKindEvent,
+    AAHNameKindParameter,
+    AAHNameKindUserProperty
+};
 
-/** Private class variables for validation regex. */
-static NSRegularExpression *_validEventNameRegex = nil;
-static NSRegularExpression *_validParameterNameRegex = nil;
-static NSRegularExpression *_validUserPropertyNameRegex = nil;
+/**
+ * Intern table slot. The canonical string is published last (with release semantics), so a reader that
+ * sees it non-zero also sees the hash and ID, which never change afterwards.
+ */
+typedef struct {
+    _Atomic(uintptr_t) string;  // retained, immutable CFStringRef
+    NSUInteger hash;
+    AAHNameID nameID;
+} AAHInternSlot;
+
+/** Private class variables for name interning. */
+static AAHInternSlot _internSlots[kInternTableCapacity];
+static _Atomic(uintptr_t) _internNames[kInternMaxNames + 1];        // canonical string by ID (owned by the slot)
+static _Atomic(uint8_t) _internValidation[kInternMaxNames + 1];     // memoized validation results by ID (see AAHCheckName)
+static AAHNameID _internCount = 0;
+static _Atomic(uint64_t) _internFullCount;     // names not interned because the table was full
+static AAHNameID _internSeededCount = 0;
+static uint32_t _internSeedChecksum = 0;
+static os_unfair_lock _internLock = OS_UNFAIR_LOCK_INIT;
 
 /**
- * Compiles regex pattern for Firebase event name validation using constants above.
+ * Looks up a name without taking a lock (and without seeding the table first, see AAHFindName).
  *
- * @throws NSInvalidArgumentException if pattern string is invalid. (Test builds only.)
+ * @return ID of the name, or kAAHNameIDNone if it has not been interned.
  */
-+ (void)makeEventNameRegex {
-    NSError *err = nil;
-    NSString *pattern = [NSString stringWithFormat:kValidationEventNamePattern, kValidationEventNameMaxLength-1];
-    _validEventNameRegex = [NSRegularExpression regularExpressionWithPattern:pattern options:0 error:&err];
-    if (nil != err && [self isDebugBuild]) {
-        [[NSException exceptionWithName:NSInvalidArgumentException reason:@"Invalid regex pattern for Firebase event name validation" userInfo:nil] raise];
+static AAHNameID AAHLookupName(NSString *name, NSUInteger hash) {
+    for (NSUInteger probe = 0; probe < kInternTableCapacity; probe++) {
+        AAHInternSlot *slot = &_internSlots[(hash + probe) & (kInternTableCapacity - 1)];
+        uintptr_t string = atomic_load_explicit(&slot->string, memory_order_acquire);
+        if (0 == string) {
+            return kAAHNameIDNone;
+        }
+        if (slot->hash == hash && (string == (uintptr_t)(__bridge void *)name || CFEqual((CFStringRef)string, (__bridge CFStringRef)name))) {
+            return slot->nameID;
+        }
     }
+    return kAAHNameIDNone;
 }
 
 /**
- * Compiles regex pattern for Firebase parameter name validation using constants above.
+ * Interns a name if needed (without seeding the table first, see AAHInternName).
  *
- * @throws NSInvalidArgumentException if pattern string is invalid. (Test builds only.)
+ * @return ID of the name, or kAAHNameIDNone if the table is full.
  */
-+ (void)makeParameterNameRegex {
-    NSError *err = nil;
-    NSString *pattern = [NSString stringWithFormat:kValidationParameterNamePattern, kValidationParameterNameMaxLength-1];
-    _validParameterNameRegex = [NSRegularExpression regularExpressionWithPattern:pattern options:0 error:&err];
-    if (nil != err && [self isDebugBuild]) {
-        [[NSException exceptionWithName:NSInvalidArgumentException reason:@"Invalid regex pattern for Firebase parameter name validation" userInfo:nil] raise];
+static AAHNameID AAHAddName(NSString *name) {
+    NSUInteger hash = name.hash;
+    AAHNameID nameID = AAHLookupName(name, hash);
+    if (kAAHNameIDNone != nameID) {
+        return nameID;
+    }
+    
+    os_unfair_lock_lock(&_internLock);
+    nameID = AAHLookupName(name, hash);  // another thread may have interned the same name meanwhile
+    if (kAAHNameIDNone == nameID && _internCount < kInternMaxNames) {
+        NSUInteger index = hash & (kInternTableCapacity - 1);
+        while (0 != atomic_load_explicit(&_internSlots[index].string, memory_order_relaxed)) {
+            index = (index + 1) & (kInternTableCapacity - 1);
+        }
+        AAHInternSlot *slot = &_internSlots[index];
+        nameID = ++_internCount;
+        uintptr_t canonical = (uintptr_t)CFBridgingRetain([name copy]);
+        slot->hash = hash;
+        slot->nameID = nameID;
+        atomic_store_explicit(&_internNames[nameID], canonical, memory_order_release);
+        atomic_store_explicit(&slot->string, canonical, memory_order_release);
+    } else if (kAAHNameIDNone == nameID) {
+        atomic_fetch_add_explicit(&_internFullCount, 1, memory_order_relaxed);
     }
+    os_unfair_lock_unlock(&_internLock);
+    return nameID;
 }
 
+/** Seeds the intern table exactly once, before any other name is interned (see AAHSeedInternTable). */
+static dispatch_once_t _internSeedOnce;
+
 /**
- * Compiles regex pattern for Firebase user property name validation using constants above.
- *
- * @throws NSInvalidArgumentException if pattern string is invalid. (Test builds only.)
+ * Seeds the intern table with the event, parameter, and user property name constants from AAHAnalyticsHelper.h.
+ * Seeded names get IDs 1...N on every launch (as long as this list is unchanged), so they can be stored by ID
+ * on disk (see the event journal and trace files).
  */
-+ (void)makeUserPropertyNameRegex {
-    NSError *err = nil;
-    NSString *pattern = [NSString stringWithFormat:kValidationUserPropertyNamePattern, kValidationUserPropertyNameMaxLength-1];
-    _validUserPropertyNameRegex = [NSRegularExpression regularExpressionWithPattern:pattern options:0 error:&err];
-    if (nil != err && [self isDebugBuild]) {
-        [[NSException exceptionWithName:NSInvalidArgumentException reason:@"Invalid regex pattern for Firebase user property name validation" userInfo:nil] raise];
+static void AAHSeedInternTable(void *context) {
+    NSArray<NSString *> *seeds = @[
+        // events
+        kAAHAnalyticsHelperEventScreenView,
+        kAAHAnalyticsHelperEventValidationError,
+        // parameters
+        kAAHAnalyticsHelperParameterScreenName,
+        kAAHAnalyticsHelperParameterScreenClass,
+        kAAHAnalyticsHelperParameterTimestamp,
+        kAAHAnalyticsHelperParameterErrorMessage,
+        kAAHAnalyticsHelperParameterAggregateCount,
+        kAAHAnalyticsHelperParameterErrorCount,
+        kAAHAnalyticsHelperParameterErrorNames,
+        // user properties
+        kAAHAnalyticsHelperUserPropertyEnvironment,
+        kAAHAnalyticsHelperUserPropertyAppInstanceID,
+        kAAHAnalyticsHelperUserPropertyTimezoneOffset
+    ];
+    
+    // FNV-1a checksum of the seeded names and their IDs, to detect a changed list on the next launch
+    uint32_t checksum = 2166136261u;
+    for (NSString *seed in seeds) {
+        AAHNameID nameID = AAHAddName(seed);
+        checksum = (checksum ^ (uint8_t)nameID) * 16777619u;
+        const char *bytes = seed.UTF8String;
+        size_t length = strlen(bytes);
+        for (size_t i = 0; i <= length; i++) {  // includes the terminator, as a separator
+            checksum = (checksum ^ (uint8_t)bytes[i]) * 16777619u;
+        }
     }
+    _internSeededCount = _internCount;
+    _internSeedChecksum = checksum;
+}
+
+/** Seeds the intern table if it hasn't been seeded yet (a single load afterwards). */
+static inline void AAHEnsureInternTableSeeded(void) {
+    dispatch_once_f(&_internSeedOnce, NULL, AAHSeedInternTable);
 }
 
 /**
- * Indicates whether regex compiled successfully.
+ * Looks up a name without taking a lock.
  *
- * @return True if regex patterns compiled.
+ * Seeds the table first, so the seeds keep their IDs even if a name is looked up before this class is
+ * initialized (e.g., by an event schema).
+ *
+ * @return ID of the name, or kAAHNameIDNone if it has not been interned.
  */
-+ (BOOL)isRegexReady {
-    return nil != _validEventNameRegex && nil != _validParameterNameRegex && nil != _validUserPropertyNameRegex;
+static AAHNameID AAHFindName(NSString *name, NSUInteger hash) {
+    AAHEnsureInternTableSeeded();
+    return AAHLookupName(name, hash);
 }
 
-/** Private class variables for validation/enforcement of Firebase rules (see setters below). */
-static BOOL _validateInDebug = YES;
-static BOOL _validateInProduction = NO;
-static BOOL _throwOnValidationErrorsInDebug = NO;
-static BOOL _sendValidationErrorEvents = NO;
-static BOOL _truncateStringValues = YES;
-
 /**
- * Controls whether Firebase validation is performed in debug builds. Default is true.
+ * Returns the ID of a name, interning it first if needed. Lookups of names already interned are lock-free;
+ * interning a new name takes a lock.
+ *
+ * Only the seeds and names that passed validation are interned (see AAHCheckName), so distinct invalid
+ * names (e.g., built from user input) can't fill the table.
+ *
+ * @return ID of the name, or kAAHNameIDNone if the table is full.
  */
-+ (void)setValidateInDebug:(BOOL)enable { _validateInDebug = enable; }
+static AAHNameID AAHInternName(NSString *name) {
+    AAHEnsureInternTableSeeded();
+    return AAHAddName(name);
+}
 
 /**
- * Controls whether Firebase validation in performed in release builds. Default is false.
+ * Returns the canonical string of an interned name.
  *
- * If enabled, only sends custom error events to Firebase, no logging or exceptions.
+ * @return Canonical string, or nil if no name has this ID.
  */
-+ (void)setValidateInProduction:(BOOL)enable { _validateInProduction = enable; }
+static NSString *AAHInternedName(AAHNameID nameID) {
+    if (kAAHNameIDNone == nameID || nameID > kInternMaxNames) {
+        return nil;
+    }
+    return (__bridge NSString *)(void *)atomic_load_explicit(&_internNames[nameID], memory_order_acquire);
+}
 
 /**
- * Controls whether custom validation error events are sent to Firebase. Default is false.
+ * Creates the intern table, seeded with the name constants from AAHAnalyticsHelper.h (see AAHSeedInternTable).
  */
-+ (void)setSendValidationErrorEvents:(BOOL)enable { _sendValidationErrorEvents = enable; }
++ (void)makeInternTable {
+    AAHEnsureInternTableSeeded();
+}
+
+// MARK: - Parameter providers
+
+/** Private class variables for parameter providers (see setParameterProvider:forName:eventNames: below). */
+static BOOL _hasParameterProviders = NO;
+static NSString *_providerNames[kMaxParameterProviders];
+static AAHParameterProvider _providers[kMaxParameterProviders];
+static _Atomic(uint8_t) _globalProviderMask;                    // providers for all events
+static _Atomic(uint8_t) _providerMasks[kInternMaxNames + 1];    // providers by interned event name
+static os_unfair_lock _providersLock = OS_UNFAIR_LOCK_INIT;
 
 /**
- * Controls whether InvalidArgument exceptions are thrown for Firebase validation errors
- * in debug builds. Default is false.
- */
-+ (void)setThrowOnValidationErrorsInDebug:(BOOL)enable { _throwOnValidationErrorsInDebug = enable; }
-
-/**
- * Controls whether string values in event parameters and user properties are truncated to
- * the maximum lengths allowed before passing to Firebase. Default is true.
+ * Registers a provider for a dynamic event parameter (e.g., a session ID), replacing any provider previously
+ * registered for the same parameter name. Passing nil removes the provider.
  *
- * While "validation" is about awareness of issues, this setting is about "enforcement", to
- * prevent Firebase from dropping parameters and user properties that exceed the allowable
- * lengths. If enabled, it applies regardless of build type or whether validation is enabled.
+ * Fixed parameters belong in setDefaultEventParameters:, which validates them once and leaves them to Firebase.
+ * Providers are for values that change, and are only called for the events they're registered for, when an event
+ * doesn't set the parameter itself. They're called when the event is prepared (on the logging queue if asynchronous
+ * logging is enabled), so they must be cheap and thread-safe. A provider returning nil adds no parameter.
  *
- * Alternatively, use truncateParam: and truncateUserProp: to trim only those string values
- * that may potentially exceed the max.
+ * @param provider Block returning the parameter value for an event (or nil to remove the provider).
+ * @param name Name of the parameter.
+ * @param eventNames Names of the events that get the parameter (nil for all events).
+ * @return False if the maximum of 8 providers is already registered.
  */
-+ (void)setTruncateStringValues:(BOOL)enable { _truncateStringValues = enable; }
++ (BOOL)setParameterProvider:(nullable AAHParameterProvider)provider forName:(nonnull NSString *)name eventNames:(nullable NSArray<NSString *> *)eventNames {
+    os_unfair_lock_lock(&_providersLock);
+    NSUInteger slot = kMaxParameterProviders;
+    for (NSUInteger i = 0; i < kMaxParameterProviders && slot == kMaxParameterProviders; i++) {
+        if ([_providerNames[i] isEqualToString:name]) {
+            slot = i;
+        }
+    }
+    for (NSUInteger i = 0; i < kMaxParameterProviders && slot == kMaxParameterProviders && nil != provider; i++) {
+        if (nil == _providerNames[i]) {
+            slot = i;
+        }
+    }
+    if (slot == kMaxParameterProviders) {
+        os_unfair_lock_unlock(&_providersLock);
+        return (nil == provider);
+    }
+    
+    // clear the slot's bit for all events, then set it again for the new provider's events
+    uint8_t bit = (uint8_t)(1u << slot);
+    atomic_fetch_and_explicit(&_globalProviderMask, (uint8_t)~bit, memory_order_relaxed);
+    for (NSUInteger i = 0; i <= kInternMaxNames; i++) {
+        atomic_fetch_and_explicit(&_providerMasks[i], (uint8_t)~bit, memory_order_relaxed);
+    }
+    _providerNames[slot] = (nil == provider) ? nil : AAHCanonicalName(AAHNameKindParameter, name);
+    _providers[slot] = [provider copy];
+    if (nil != provider && nil == eventNames) {
+        atomic_fetch_or_explicit(&_globalProviderMask, bit, memory_order_relaxed);
+    }
+    for (NSString *eventName in (nil == provider) ? nil : eventNames) {
+        AAHNameID nameID = AAHRuleNameID(eventName);
+        if (kAAHNameIDNone != nameID) {
+            atomic_fetch_or_explicit(&_providerMasks[nameID], bit, memory_order_relaxed);
+        }
+    }
+    BOOL hasProviders = NO;
+    for (NSUInteger i = 0; i < kMaxParameterProviders; i++) {
+        hasProviders = hasProviders || (nil != _providers[i]);
+    }
+    _hasParameterProviders = hasProviders;
+    os_unfair_lock_unlock(&_providersLock);
+    return YES;
+}
 
 /**
- * Determines whether validation rules should be applied.
- *
- * @return True if validation should be applied.
+ * Returns whether any parameter provider is registered (see setParameterProvider:forName:eventNames:).
  */
-+ (BOOL)isValidationEnabled {
-    return ((_validateInDebug && [self isDebugBuild]) || (_validateInProduction && ![self isDebugBuild])) && [self isRegexReady];
++ (BOOL)hasParameterProviders {
+    return _hasParameterProviders;
 }
 
 /**
- * If validation is enabled, checks the event name, parameter count, and parameter names and values against the Firebase/GA4 rules.
+ * Appends the parameters of the providers registered for an event, except those the event sets itself.
  *
- * See: https://firebase.google.com/docs/reference/ios/firebaseanalytics/api/reference/Classes/FIRAnalytics#logeventwithnameparameters
- *
- * @param name Name of the event.
- * @param parameters Dictionary of event parameters (optional).
+ * @param eventName The name of the event.
+ * @param names Parameter names (with room for kMaxParameterProviders more parameters).
+ * @param values Parameter values (with room for kMaxParameterProviders more parameters).
+ * @param count Number of parameters.
+ * @param newValues Array that keeps the appended names and values alive until the event's dictionary is built (created if needed).
+ * @return New number of parameters.
  */
-+ (void)validateEventWithName:(nonnull NSString*)name parameters:(nullable NSDictionary*)parameters {
-    if ([self isValidationEnabled]) {
-        // validate event name
-        bool isInvalidName = [_validEventNameRegex numberOfMatchesInString:name options:0 range:NSMakeRange(0, [name length])] != 1;
-        if (isInvalidName) {
-            NSString *errorMessage = [NSString stringWithFormat:@"Invalid event name '%@'", name];
-            [self handleValidationError:errorMessage];
++ (NSUInteger)appendProvidedParametersForEventWithName:(nonnull NSString *)eventName names:(__unsafe_unretained NSString *_Nonnull *_Nonnull)names values:(__unsafe_unretained id _Nonnull *_Nonnull)values count:(NSUInteger)count newValues:(NSMutableArray *_Nullable __strong *_Nonnull)newValues {
+    uint8_t mask = atomic_load_explicit(&_globalProviderMask, memory_order_relaxed) | atomic_load_explicit(&_providerMasks[AAHFindName(eventName, eventName.hash)], memory_order_relaxed);
+    if (0 == mask) {
+        return count;
+    }
+    // snapshot the providers, so they are called without holding the lock
+    NSString *providerNames[kMaxParameterProviders];
+    AAHParameterProvider providers[kMaxParameterProviders];
+    os_unfair_lock_lock(&_providersLock);
+    for (NSUInteger i = 0; i < kMaxParameterProviders; i++) {
+        if (mask & (1u << i)) {
+            providerNames[i] = _providerNames[i];
+            providers[i] = _providers[i];
+        }
+    }
+    os_unfair_lock_unlock(&_providersLock);
+    
+    NSUInteger eventCount = count;
+    for (NSUInteger i = 0; i < kMaxParameterProviders; i++) {
+        if (nil == providers[i]) {
+            continue;
         }
-        // validate parameter count
-        if (nil != parameters) {
-            NSUInteger parameterCount = parameters.count;
-            bool isInvalidCount = parameterCount > kValidationEventMaxParameters;
-            if (isInvalidCount) {
-                NSString *errorMessage = [NSString stringWithFormat:@"Too many parameters in event '%@': contains %ld, max %d", name, parameterCount, kValidationEventMaxParameters];
-                [self handleValidationError:errorMessage];
+        BOOL isSetByEvent = NO;
+        for (NSUInteger j = 0; j < eventCount && !isSetByEvent; j++) {
+            isSetByEvent = (names[j] == providerNames[i]) || [names[j] isEqual:providerNames[i]];
+        }
+        id value = isSetByEvent ? nil : providers[i](eventName);
+        if (nil != value) {
+            if (nil == *newValues) {
+                *newValues = [NSMutableArray array];
             }
+            [*newValues addObject:providerNames[i]];
+            [*newValues addObject:value];
+            names[count] = providerNames[i];
+            values[count] = value;
+            count++;
         }
-        // validate parameters
-        [self validateParameters:parameters source:name];
     }
+    return count;
 }
 
+// MARK: - Sampling and rate limiting
+
+/** Throttle rule flags. */
+typedef NS_OPTIONS(uint8_t, AAHThrottleFlags) {
+    AAHThrottleFlagSampled = 1 << 0,
+    AAHThrottleFlagRateLimited = 1 << 1
+};
+
 /**
- * If validation is enabled, checks each event parameter name and value against the Firebase/GA4 rules.
- *
- * See: https://firebase.google.com/docs/reference/ios/firebaseanalytics/api/reference/Classes/FIRAnalytics#logeventwithnameparameters
- *
- * @param parameters Dictionary of event parameters (optional).
- * @param source Source of the parameters (for error message use).
+ * Sampling and rate limit rule for one event name, indexed by the name's interned ID. Flags are checked
+ * without a lock; the token bucket is only touched (under its lock) for rate-limited events.
  */
-+ (void)validateParameters:(nullable NSDictionary*)parameters source:(nonnull NSString*)source {
-    if (parameters && [self isValidationEnabled]) {
-        for(id name in parameters.allKeys) {
-            // validate parameter name
-            bool isInvalidName = [_validParameterNameRegex numberOfMatchesInString:name options:0 range:NSMakeRange(0, [name length])] != 1;
-            if (isInvalidName) {
-                NSString *errorMessage = [NSString stringWithFormat:@"Invalid parameter name '%@' in '%@'", name, source];
-                [self handleValidationError:errorMessage];
-            }
-            // validate parameter value
-            id value = [parameters valueForKey:name];
-            if ([name isEqualToString:@"items"]) {
-                // special handling required for Ecommerce "items" parameter, which contains an array of products
-                for (id product in value) {
-                    if ([product isKindOfClass:[NSDictionary class]]) {
-                        [self validateParameters:product source:[source stringByAppendingString:@" [items]"]];
-                    }
-                }
-            } else {
-                // normal event parameter
-                bool isInvalidValue = [value isKindOfClass:[NSString class]] && [value length] > kValidationParameterValueMaxLength;
-                if (isInvalidValue) {
-                    NSString *errorMessage = [NSString stringWithFormat:@"Value too long for parameter '%@' in '%@': %@", name, source, value];
-                    [self handleValidationError:errorMessage];
-                }
-            }
+typedef struct {
+    _Atomic(uint8_t) flags;
+    _Atomic(uint32_t) sampleThreshold;  // an event is kept if a random 32-bit value is below this
+    os_unfair_lock bucketLock;
+    double bucketCapacity;
+    double tokensPerSecond;
+    double tokens;
+    uint64_t lastRefill;                // nanoseconds (CLOCK_UPTIME_RAW)
+    _Atomic(uint64_t) sampledOutCount;
+    _Atomic(uint64_t) rateLimitedCount;
+} AAHThrottleRule;
+
+/** Private class variables for sampling and rate limiting (see setThrottleRules: below). */
+static BOOL _hasThrottleRules = NO;
+static AAHThrottleRule _throttleRules[kInternMaxNames + 1];
+static os_unfair_lock _throttleConfigLock = OS_UNFAIR_LOCK_INIT;
+static _Thread_local uint64_t _throttleRandomState = 0;
+
+/**
+ * Returns a fast per-thread pseudo-random 32-bit value (xorshift64*), good enough for sampling decisions.
+ */
+static inline uint32_t AAHThrottleRandom(void) {
+    uint64_t x = _throttleRandomState;
+    if (0 == x) {
+        x = ((uint64_t)arc4random() << 32) | arc4random() | 1;
+    }
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    _throttleRandomState = x;
+    return (uint32_t)((x * 0x2545F4914F6CDD1DULL) >> 32);
+}
+
+/**
+ * Applies an event's sample rate and token bucket (slow path of AAHShouldDropEvent).
+ */
+static BOOL AAHThrottleEvent(AAHThrottleRule *rule, uint8_t flags) {
+    if ((flags & AAHThrottleFlagSampled) && AAHThrottleRandom() >= atomic_load_explicit(&rule->sampleThreshold, memory_order_relaxed)) {
+        atomic_fetch_add_explicit(&rule->sampledOutCount, 1, memory_order_relaxed);
+        return YES;
+    }
+    if (flags & AAHThrottleFlagRateLimited) {
+        os_unfair_lock_lock(&rule->bucketLock);
+        uint64_t now = clock_gettime_nsec_np(CLOCK_UPTIME_RAW);
+        double elapsed = (double)(now - rule->lastRefill) / NSEC_PER_SEC;
+        rule->tokens = MIN(rule->bucketCapacity, rule->tokens + elapsed * rule->tokensPerSecond);
+        rule->lastRefill = now;
+        BOOL isLimited = (rule->tokens < 1);
+        if (!isLimited) {
+            rule->tokens -= 1;
+        }
+        os_unfair_lock_unlock(&rule->bucketLock);
+        if (isLimited) {
+            atomic_fetch_add_explicit(&rule->rateLimitedCount, 1, memory_order_relaxed);
+            return YES;
         }
     }
+    return NO;
+}
+
+/**
+ * Indicates whether an event should be dropped by its sample rate or rate limit. Runs before any other work
+ * on the event; an event without a rule costs one lock-free lookup and one branch.
+ */
+static inline BOOL AAHShouldDropEvent(NSString *name) {
+    if (!_hasThrottleRules) {
+        return NO;
+    }
+    AAHNameID nameID = AAHFindName(name, name.hash);
+    uint8_t flags = atomic_load_explicit(&_throttleRules[nameID].flags, memory_order_relaxed);
+    if (0 == flags) {
+        return NO;
+    }
+    return AAHThrottleEvent(&_throttleRules[nameID], flags);
 }
 
 /**
- * If validation is enabled, checks the user property name and value against the Firebase/GA4 rules.
+ * Sets per-event-name sampling and rate limit rules, replacing any previous rules. Passing nil removes all rules.
  *
- * See: https://firebase.google.com/docs/reference/ios/firebaseanalytics/api/reference/Classes/FIRAnalytics#setuserpropertystringforname
+ * Each rule is a dictionary with any of the following keys:
+ * - "sample_rate": share of events to keep, from 0.0 to 1.0
+ * - "max_per_minute": sustained number of events allowed per minute (token bucket refill rate)
+ * - "burst": number of events allowed in a burst (token bucket capacity, default is max_per_minute)
  *
- * @param value Value of the user property.
- * @param name Name of the user property
+ * Rules can be loaded at runtime, e.g. from a Remote Config JSON parameter:
+ * `[AAHAnalyticsHelper setThrottleRules:[[FIRRemoteConfig remoteConfig] configValueForKey:@"analytics_throttle"].JSONValue]`,
+ * with a value like `{"scroll_depth": {"sample_rate": 0.1}, "view_item": {"max_per_minute": 30, "burst": 10}}`.
+ *
+ * @param rules Dictionary of rules by event name.
  */
-+ (void)validateUserProperty:(nullable NSString*)value forName:(nonnull NSString*)name {
-    if ([self isValidationEnabled]) {
-        // validate user property name
-        bool isInvalidName = [_validUserPropertyNameRegex numberOfMatchesInString:name options:0 range:NSMakeRange(0, [name length])] != 1;
-        if (isInvalidName) {
-            NSString *errorMessage = [NSString stringWithFormat:@"Invalid user property name '%@'", name];
-            [self handleValidationError:errorMessage];
++ (void)setThrottleRules:(nullable NSDictionary<NSString *, NSDictionary<NSString *, NSNumber *> *> *)rules {
+    os_unfair_lock_lock(&_throttleConfigLock);
+    for (NSUInteger i = 0; i <= kInternMaxNames; i++) {
+        atomic_store_explicit(&_throttleRules[i].flags, 0, memory_order_relaxed);
+    }
+    __block BOOL hasRules = NO;
+    [rules enumerateKeysAndObjectsUsingBlock:^(NSString *name, NSDictionary<NSString *, NSNumber *> *rule, BOOL *stop) {
+        if (![name isKindOfClass:[NSString class]] || ![rule isKindOfClass:[NSDictionary class]]) {
+            return;
         }
-        // validate user property value
-        bool isInvalidValue = [value length] > kValidationUserPropertyValueMaxLength;
-        if (isInvalidValue) {
-            NSString *errorMessage = [NSString stringWithFormat:@"Value too long for user property '%@': %@", name, value];
-            [self handleValidationError:errorMessage];
+        AAHNameID nameID = AAHRuleNameID(name);
+        if (kAAHNameIDNone == nameID) {
+            return;
         }
-    }
+        AAHThrottleRule *throttle = &_throttleRules[nameID];
+        uint8_t flags = 0;
+        
+        NSNumber *sampleRate = rule[@"sample_rate"];
+        if ([sampleRate isKindOfClass:[NSNumber class]] && sampleRate.doubleValue < 1.0) {
+            atomic_store_explicit(&throttle->sampleThreshold, (uint32_t)(MAX(sampleRate.doubleValue, 0.0) * UINT32_MAX), memory_order_relaxed);
+            flags |= AAHThrottleFlagSampled;
+        }
+        NSNumber *maxPerMinute = rule[@"max_per_minute"];
+        if ([maxPerMinute isKindOfClass:[NSNumber class]] && maxPerMinute.doubleValue >= 0) {
+            NSNumber *burst = rule[@"burst"];
+            os_unfair_lock_lock(&throttle->bucketLock);
+            throttle->tokensPerSecond = maxPerMinute.doubleValue / 60.0;
+            throttle->bucketCapacity = [burst isKindOfClass:[NSNumber class]] ? MAX(burst.doubleValue, 1.0) : MAX(maxPerMinute.doubleValue, 1.0);
+            throttle->tokens = throttle->bucketCapacity;
+            throttle->lastRefill = clock_gettime_nsec_np(CLOCK_UPTIME_RAW);
+            os_unfair_lock_unlock(&throttle->bucketLock);
+            flags |= AAHThrottleFlagRateLimited;
+        }
+        atomic_store_explicit(&throttle->flags, flags, memory_order_release);
+        hasRules = hasRules || (0 != flags);
+    }];
+    _hasThrottleRules = hasRules;
+    os_unfair_lock_unlock(&_throttleConfigLock);
 }
 
 /**
- * If validation is enabled, checks the user ID against the Firebase/GA4 rules.
- *
- * See: https://firebase.google.com/docs/reference/ios/firebaseanalytics/api/reference/Classes/FIRAnalytics#setuserid
+ * Returns the number of events dropped by sampling and rate limiting since the app launched.
  *
- * @param userID Value of the user ID.
+ * Keys: "sampled_out" and "rate_limited" (totals), and "events" (the same counts by event name).
  */
-+ (void)validateUserID:(nullable NSString*)userID {
-    if (userID && [self isValidationEnabled]) {
-        bool isInvalidValue = [userID length] > kValidationUserIdValueMaxLength;
-        if (isInvalidValue) {
-            NSString *errorMessage = [NSString stringWithFormat:@"User ID is too long: %@", userID];
-            [self handleValidationError:errorMessage];
++ (nonnull NSDictionary<NSString *, id> *)throttleStatistics {
+    uint64_t sampledOut = 0;
+    uint64_t rateLimited = 0;
+    NSMutableDictionary *events = [NSMutableDictionary dictionary];
+    for (AAHNameID nameID = 1; nameID <= kInternMaxNames; nameID++) {
+        uint64_t sampledOutCount = atomic_load_explicit(&_throttleRules[nameID].sampledOutCount, memory_order_relaxed);
+        uint64_t rateLimitedCount = atomic_load_explicit(&_throttleRules[nameID].rateLimitedCount, memory_order_relaxed);
+        NSString *name = AAHInternedName(nameID);
+        if (nil == name || (0 == sampledOutCount && 0 == rateLimitedCount)) {
+            continue;
         }
+        events[name] = @{@"sampled_out": @(sampledOutCount), @"rate_limited": @(rateLimitedCount)};
+        sampledOut += sampledOutCount;
+        rateLimited += rateLimitedCount;
     }
+    return @{@"sampled_out": @(sampledOut), @"rate_limited": @(rateLimited), @"events": events};
+}
+
+// MARK: - Event aggregation
+
+/** Maximum number of products in an "items" array (Firebase/GA4 limit), also applied to aggregated items. */
+static const NSUInteger kAggregationItemsMaxCount = 200;
+
+/** Private class variables for event aggregation (see setAggregationRules: below). */
+static BOOL _hasAggregationRules = NO;
+static _Atomic(bool) _aggregatedNames[kInternMaxNames + 1];
+static NSDictionary<NSString *, NSDictionary *> *_aggregationRules = nil;
+static NSMutableDictionary<NSString *, AAHEventAggregate *> *_aggregates = nil;
+static os_unfair_lock _aggregationLock = OS_UNFAIR_LOCK_INIT;
+
+/**
+ * Indicates whether an event name has an aggregation rule (one lock-free lookup, or a single flag test if
+ * there are no rules at all).
+ */
+static inline BOOL AAHIsAggregatedEvent(NSString *name) {
+    if (!_hasAggregationRules) {
+        return NO;
+    }
+    return atomic_load_explicit(&_aggregatedNames[AAHFindName(name, name.hash)], memory_order_relaxed);
 }
 
 /**
- * Handles the validation error by logging it, sending a custom error event, and/or throwing an NSInvalidArgumentException exception.
+ * Sets rules for coalescing repetitive events, replacing any previous rules. Passing nil removes all rules.
  *
- * Behavior is controlled via the "validation" configuration properties. (Logging and exceptions are limited to debug builds only.)
+ * Events logged via logEventWithName:parameters: with a rule are held for a short window per event name and
+ * combination of key parameter values, then logged as one summary event. The summary event keeps the key
+ * parameters and the first event's timestamp, sums numeric parameters, keeps the latest value of other
+ * parameters, concatenates "items" arrays (up to 200 products), and adds an "aggregate_count" parameter.
  *
- * @param errorMessage The message to be communicated.message.
- * @throws NSInvalidArgumentException if exception option is enabled. (Test builds only.)
+ * Each rule is a dictionary with the keys "key_parameters" (array of parameter names) and "window"
+ * (seconds, default 2), so rules can be loaded at runtime, e.g. from a Remote Config JSON value
+ * like `{"view_item": {"key_parameters": ["item_list_id"], "window": 2}}`.
+ *
+ * Note that held events are lost if the app is killed before their window ends (see flushAggregatedEvents).
+ *
+ * @param rules Dictionary of rules by event name.
  */
-+ (void)handleValidationError:(nonnull NSString*)errorMessage {
-    // log error (debug builds only)
-    if ([self isDebugBuild]) {
-        NSLog(@"ERROR: %@", errorMessage);
++ (void)setAggregationRules:(nullable NSDictionary<NSString *, NSDictionary *> *)rules {
+    os_unfair_lock_lock(&_aggregationLock);
+    for (NSUInteger i = 0; i <= kInternMaxNames; i++) {
+        atomic_store_explicit(&_aggregatedNames[i], false, memory_order_relaxed);
     }
-    // error event option (available in debug and production)
-    if (_sendValidationErrorEvents) {
-        if([errorMessage length] > kValidationParameterValueMaxLength) {
-            // truncate message
-            errorMessage = [NSString stringWithFormat:@"%@...",[errorMessage substringToIndex:kValidationParameterValueMaxLength-3]];
+    NSMutableDictionary *newRules = [NSMutableDictionary dictionaryWithCapacity:rules.count];
+    [rules enumerateKeysAndObjectsUsingBlock:^(NSString *name, NSDictionary *rule, BOOL *stop) {
+        if (![name isKindOfClass:[NSString class]] || ![rule isKindOfClass:[NSDictionary class]]) {
+            return;
         }
-        NSDictionary *errorParams = @{kAAHAnalyticsHelperParameterErrorMessage: errorMessage};
-        [FIRAnalytics logEventWithName:kAAHAnalyticsHelperEventValidationError parameters:errorParams];
-    }
-    // NSInvalidArgumentException option (debug builds only)
-    // note that the exception will prevent an error event (see above) from being sent
-    if (_throwOnValidationErrorsInDebug && [self isDebugBuild]) {
-        [[NSException exceptionWithName:NSInvalidArgumentException reason:errorMessage userInfo:nil] raise];
+        AAHNameID nameID = AAHRuleNameID(name);
+        if (kAAHNameIDNone == nameID) {
+            return;
+        }
+        NSArray *keyParameters = [rule[@"key_parameters"] isKindOfClass:[NSArray class]] ? rule[@"key_parameters"] : @[];
+        NSNumber *window = [rule[@"window"] isKindOfClass:[NSNumber class]] ? rule[@"window"] : @2;
+        newRules[name] = @{@"key_parameters": [keyParameters copy], @"window": window};
+        atomic_store_explicit(&_aggregatedNames[nameID], true, memory_order_relaxed);
+    }];
+    _aggregationRules = newRules;
+    if (nil == _aggregates) {
+        _aggregates = [[NSMutableDictionary alloc] init];
     }
-    
+    _hasAggregationRules = (newRules.count > 0);
+    os_unfair_lock_unlock(&_aggregationLock);
 }
 
-// MARK: - Firebase/GA4 DebugView
+/**
+ * Logs all held aggregates now instead of waiting for their windows to end (e.g., when the app enters the background).
+ */
++ (void)flushAggregatedEvents {
+    os_unfair_lock_lock(&_aggregationLock);
+    NSArray<NSString *> *keys = _aggregates.allKeys;
+    os_unfair_lock_unlock(&_aggregationLock);
+    for (NSString *key in keys) {
+        [self emitAggregateForKey:key window:nil];
+    }
+}
 
 /**
- * Indicates whether events should be sent to DebugView in the Firebase console and GA4 property.
+ * Adds an event to the aggregate for its event name and key parameter values, starting a new window if needed.
  *
- * Default implementation is based on DEBUG flag, but you can customize this to enable DebugView for
- * select "release" builds that are used for testing. Do NOT enable for true production builds!
- *
- * To enable DebugView, call `[AAHAnalyticsHelper setFirebaseLaunchArguments]` before
- * calling `[FIRApp configure]`(see below).
+ * @param name The name of the event.
+ * @param parameters Dictionary of event parameters (optional).
+ * @return Whether the event was added (NO if its rule was removed meanwhile, in which case it should be logged normally).
  */
-+ (BOOL)sendToDebugView {
-    #if DEBUG
++ (BOOL)aggregateEventWithName:(nonnull NSString *)name parameters:(nullable NSDictionary<NSString *, id> *)parameters {
+    os_unfair_lock_lock(&_aggregationLock);
+    NSDictionary *rule = _aggregationRules[name];
+    if (nil == rule) {
+        os_unfair_lock_unlock(&_aggregationLock);
+        return NO;
+    }
+    NSArray<NSString *> *keyParameters = rule[@"key_parameters"];
+    NSMutableString *key = [NSMutableString stringWithString:name];
+    for (NSString *keyParameter in keyParameters) {
+        [key appendFormat:@"\x1F%@", parameters[keyParameter] ?: @""];
+    }
+    AAHEventAggregate *aggregate = _aggregates[key];
+    BOOL isNewWindow = (nil == aggregate);
+    if (isNewWindow) {
+        aggregate = [[AAHEventAggregate alloc] init];
+        aggregate.name = [name copy];
+        aggregate.parameters = [NSMutableDictionary dictionary];
+        aggregate.timestamp = [self getTimestamp];
+        _aggregates[key] = aggregate;
+    }
+    [self mergeParameters:parameters intoAggregate:aggregate keyParameters:keyParameters];
+    os_unfair_lock_unlock(&_aggregationLock);
+    
+    if (isNewWindow) {
+        dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)([rule[@"window"] doubleValue] * NSEC_PER_SEC)), dispatch_get_global_queue(QOS_CLASS_UTILITY, 0), ^{
+            [self emitAggregateForKey:key window:aggregate];
+        });
+    }
     return YES;
-    #else
-    return NO;
-    #endif
 }
 
 /**
- * Forces the app to send Firebase events to the DebugView pane in the Firebase console or GA4 property.
+ * Combines an event's parameters into its aggregate (see setAggregationRules: for how each kind of value is combined).
  *
- * Useful for testing builds that are not launched directly from Xcode.
+ * Called while holding the aggregation lock.
+ */
++ (void)mergeParameters:(nullable NSDictionary<NSString *, id> *)parameters intoAggregate:(nonnull AAHEventAggregate *)aggregate keyParameters:(nonnull NSArray<NSString *> *)keyParameters {
+    aggregate.count++;
+    NSMutableDictionary *aggregated = aggregate.parameters;
+    [parameters enumerateKeysAndObjectsUsingBlock:^(NSString *name, id value, BOOL *stop) {
+        id existing = aggregated[name];
+        if ([keyParameters containsObject:name]) {
+            if (nil == existing) {
+                aggregated[name] = value;
+            }
+            return;
+        }
+        if (nil == existing && aggregated.count >= kValidationEventMaxParameters - 2) {
+            // leave room for the count and timestamp parameters
+            return;
+        }
+        if ([value isKindOfClass:[NSArray class]] && [name isEqualToString:@"items"]) {
+            NSMutableArray *items = [existing isKindOfClass:[NSMutableArray class]] ? existing : [NSMutableArray array];
+            NSUInteger room = kAggregationItemsMaxCount - MIN(items.count, kAggregationItemsMaxCount);
+            [items addObjectsFromArray:[value subarrayWithRange:NSMakeRange(0, MIN([value count], room))]];
+            aggregated[name] = items;
+        } else if ([value isKindOfClass:[NSNumber class]] && (nil == existing || [existing isKindOfClass:[NSNumber class]])) {
+            if (CFNumberIsFloatType((__bridge CFNumberRef)value) || (nil != existing && CFNumberIsFloatType((__bridge CFNumberRef)existing))) {
+                aggregated[name] = @([existing doubleValue] + [value doubleValue]);
+            } else {
+                aggregated[name] = @([existing longLongValue] + [value longLongValue]);
+            }
+        } else {
+            aggregated[name] = value;
+        }
+    }];
+}
+
+/**
+ * Logs the summary event for an aggregate whose window has ended, if it hasn't been logged already.
  *
- * Call this method from your AppDelegate's `application:didFinishLaunchingWithOptions:` method before
- * calling `[FIRApp configure]`.
+ * A window's timer passes its own aggregate, so a timer left over from a window that was flushed early doesn't
+ * end a newer window for the same key.
+ *
+ * @param key Aggregate key (event name and key parameter values).
+ * @param window Aggregate of the window that ended (nil for whichever window is open).
  */
-+ (void)setFirebaseLaunchArguments {
-    if ([self sendToDebugView]) {
-        NSMutableArray *newArguments = [NSMutableArray arrayWithArray:[[NSProcessInfo processInfo] arguments]];
-        [newArguments addObject:@"-FIRAnalyticsDebugEnabled"];
-        [newArguments addObject:@"-FIRDebugEnabled"];
-        [newArguments addObject:@"-FIRAnalyticsVerboseLoggingEnabled"];
-        [[NSProcessInfo processInfo] setValue:[newArguments copy] forKey:@"arguments"];
++ (void)emitAggregateForKey:(nonnull NSString *)key window:(nullable AAHEventAggregate *)window {
+    os_unfair_lock_lock(&_aggregationLock);
+    AAHEventAggregate *aggregate = _aggregates[key];
+    if (nil != window && aggregate != window) {
+        aggregate = nil;
+    }
+    if (nil != aggregate) {
+        [_aggregates removeObjectForKey:key];
+    }
+    os_unfair_lock_unlock(&_aggregationLock);
+    if (nil == aggregate) {
+        return;
     }
+    NSMutableDictionary *parameters = aggregate.parameters;
+    parameters[kAAHAnalyticsHelperParameterAggregateCount] = @(aggregate.count);
+    [self ingestEventWithName:aggregate.name parameters:parameters timestamp:aggregate.timestamp];
 }
 
-// MARK: - Google Analytics (UA) dispatch
+// MARK: - Asynchronous logging
 
 /**
- * Dispatch interval for traditional GA360 hits in production builds.
- *
- * FOR USE WITH GOOGLE TAG MANAGER, which imports the Google Analytics
- * library and exposes the GAI methods.
- *
- * By default hits are dispatched every 2 minutes when app is in the foreground.
- * Do not reduce or you risk excessive network activity and battery drain.
+ * Capacity of the buffer of pending events and settings used by asynchronous logging (must be a power of 2).
  */
-static double const kGaProductionDispatchInterval = 120;  // seconds
+#define kLoggingBufferCapacity 1024
 
-/** Dispatch handler class variable for sending GA hits in the background. */
-static void (^_dispatchHandler)(GAIDispatchResult result);
+/** Number of entries drained per autorelease pool, so temporaries are released in batches as they reach Firebase. */
+static const NSUInteger kLoggingDrainBatchSize = 32;
+
+/** Estimated memory held by a queued event, apart from its strings (dictionary, timestamp, etc.). */
+static const NSUInteger kPendingEventBaseBytes = 384;
+
+/** Estimated memory held by each parameter of a queued event, apart from its strings. */
+static const NSUInteger kPendingParameterBaseBytes = 64;
 
 /**
- * Sets the dispatch interval for GA360 (Universal Analytics) hits sent by Google Tag Manager.
+ * Preallocated slot in the logging buffer. Holds either an event (name, parameters, and timestamp) or an
+ * ordered block (settings, batches, etc.), retained while the slot is full.
  *
- * FOR USE WITH GOOGLE TAG MANAGER, which imports the Google Analytics
- * library and exposes the GAI methods.
+ * The sequence number implements a bounded lock-free queue (Dmitry Vyukov's design): a slot is free for the
+ * producer claiming position p when its sequence is p, and full for the consumer at position p when its
+ * sequence is p + 1.
+ */
+typedef struct {
+    _Atomic(uintptr_t) sequence;
+    void *name;
+    void *parameters;
+    void *timestamp;
+    void *block;
+    uint64_t journalSequence;
+    uint32_t bytes;
+} AAHLoggingSlot;
+
+/** Private class variables for asynchronous logging (see setAsynchronousLogging: below). */
+static BOOL _asynchronousLogging = NO;
+static dispatch_queue_t _loggingQueue = nil;
+static dispatch_source_t _loggingDrainSource = nil;
+static dispatch_semaphore_t _loggingSpaceSemaphore = nil;
+static AAHOverflowPolicy _overflowPolicy = AAHOverflowPolicyBlock;
+static AAHLoggingSlot _loggingSlots[kLoggingBufferCapacity];
+static _Atomic(uintptr_t) _loggingEnqueuePosition;
+static _Atomic(uintptr_t) _loggingDequeuePosition;
+static _Atomic(uintptr_t) _loggingBlockedProducers;
+static _Atomic(uint64_t) _droppedEventCount;
+static NSUInteger _pendingMemoryLimit = 0;
+static _Atomic(uintptr_t) _pendingEventBytes;
+static _Atomic(bool) _isUnderBackPressure;
+static const void *const kLoggingQueueKey = &kLoggingQueueKey;
+
+/**
+ * Creates the serial queue, buffer, and drain source used for asynchronous logging.
+ */
++ (void)makeLoggingQueue {
+    dispatch_queue_attr_t attributes = dispatch_queue_attr_make_with_qos_class(DISPATCH_QUEUE_SERIAL, QOS_CLASS_UTILITY, 0);
+    _loggingQueue = dispatch_queue_create("com.adswerve.AAHAnalyticsHelper.logging", attributes);
+    dispatch_queue_set_specific(_loggingQueue, kLoggingQueueKey, (void *)kLoggingQueueKey, NULL);
+    for (uintptr_t i = 0; i < kLoggingBufferCapacity; i++) {
+        atomic_init(&_loggingSlots[i].sequence, i);
+    }
+    _loggingSpaceSemaphore = dispatch_semaphore_create(0);
+    
+    // producers signal the drain source after each write; signals are coalesced while the queue is busy
+    _loggingDrainSource = dispatch_source_create(DISPATCH_SOURCE_TYPE_DATA_OR, 0, 0, _loggingQueue);
+    dispatch_source_set_event_handler(_loggingDrainSource, ^{
+        [self drainLoggingBuffer];
+    });
+    dispatch_resume(_loggingDrainSource);
+}
+
+/**
+ * Controls whether validation, truncation, and the hand-off to Firebase happen on a serial background
+ * queue instead of the calling thread. Default is false.
  *
- * The default GA dispatch interval for production apps is every 2 minutes (120 seconds), but
- * for debug builds it is helpful to set the interval to 1 second so hits go out immediately.
+ * When enabled, logEventWithName:parameters: only captures the timestamp and a (shallow) copy of its
+ * inputs, and writes them to a bounded buffer without taking a lock, before returning. A single drain
+ * thread validates the buffered events and passes them to Firebase. Events, user properties, and other
+ * settings are still passed to Firebase in the order they were called. Note that exceptions thrown for
+ * validation errors (see setThrowOnValidationErrorsInDebug:) are raised on the background queue.
  */
-+ (void)setDispatchInterval {
-    if([self isDebugBuild]) {
-        [GAI sharedInstance].dispatchInterval = 1;
-        [GAI sharedInstance].logger.logLevel = kGAILogLevelVerbose;
-    } else {
-        [GAI sharedInstance].dispatchInterval = kGaProductionDispatchInterval;
++ (void)setAsynchronousLogging:(BOOL)enable {
+    if (_asynchronousLogging && !enable) {
+        // finish queued work so it isn't overtaken by calls made on the caller's thread
+        [self waitForPendingEvents];
     }
+    _asynchronousLogging = enable;
 }
 
 /**
- * Sends any queued hits to GA360 (Universal Analytics) when app enters the background.
+ * Controls what happens when the asynchronous logging buffer is full (see setAsynchronousLogging:).
+ * Default is AAHOverflowPolicyBlock.
  *
- * FOR USE WITH GOOGLE TAG MANAGER, which imports the Google Analytics
- * library and exposes the GAI methods.
+ * @param policy Overflow policy.
+ */
++ (void)setOverflowPolicy:(AAHOverflowPolicy)policy {
+    _overflowPolicy = policy;
+}
+
+/**
+ * Returns the number of events dropped because the asynchronous logging buffer was full.
+ */
++ (NSUInteger)droppedEventCount {
+    return (NSUInteger)atomic_load_explicit(&_droppedEventCount, memory_order_relaxed);
+}
+
+/**
+ * Caps the memory held by events queued for asynchronous logging (see setAsynchronousLogging:). Default is 0
+ * (no cap, only the buffer capacity applies).
  *
- * Call this method from your AppDelegate's `applicationWillResignActive:` method, or from
- * `sceneWillResignActive:` if using Scenes, before the app actually enters the background.
- * Based on: https://developers.google.com/analytics/devguides/collection/ios/v3/dispatch
+ * The buffer's slots are preallocated, so the cap bounds what the queued events themselves hold (estimated
+ * from their names, parameters, and string lengths). Once it's reached, new events are handled like a full
+ * buffer, according to the overflow policy, and isUnderBackPressure returns true until the buffer is drained.
+ * Settings are never held back by the cap.
+ *
+ * @param bytes Maximum estimated bytes held by queued events (0 for no cap).
  */
-+ (void)sendHitsInBackground {
-    __block BOOL taskExpired = NO;
-    __block UIBackgroundTaskIdentifier taskId =
-    [[UIApplication sharedApplication] beginBackgroundTaskWithExpirationHandler:^{
-        taskExpired = YES;
++ (void)setPendingMemoryLimit:(NSUInteger)bytes {
+    _pendingMemoryLimit = bytes;
+}
+
+/**
+ * Indicates whether asynchronous logging has hit its buffer capacity or memory cap since its buffer was last
+ * empty. Producers of bursts (e.g., replays or prefetching) can poll this to slow down instead of blocking or
+ * having events dropped.
+ */
++ (BOOL)isUnderBackPressure {
+    return atomic_load_explicit(&_isUnderBackPressure, memory_order_relaxed);
+}
+
+/**
+ * Estimates the memory held by a queued event (see setPendingMemoryLimit:).
+ *
+ * @param name The name of the event.
+ * @param parameters Dictionary of event parameters (optional).
+ * @return Estimated bytes (at least 1).
+ */
+static uint32_t AAHEstimateEventBytes(NSString *name, NSDictionary *parameters) {
+    __block NSUInteger bytes = kPendingEventBaseBytes + name.length * sizeof(unichar);
+    [parameters enumerateKeysAndObjectsUsingBlock:^(NSString *key, id value, BOOL *stop) {
+        bytes += kPendingParameterBaseBytes + key.length * sizeof(unichar);
+        if ([value isKindOfClass:[NSString class]]) {
+            bytes += [(NSString *)value length] * sizeof(unichar);
+        } else if ([value isKindOfClass:[NSArray class]]) {
+            bytes += [(NSArray *)value count] * kPendingEventBaseBytes;  // "items" products
+        }
     }];
-    if (taskId == UIBackgroundTaskInvalid) {
-        return;
+    return (uint32_t)MIN(bytes, (NSUInteger)UINT32_MAX);
+}
+
+/**
+ * Reserves memory for a queued event under the memory cap, or returns NO if the cap would be exceeded.
+ * An event is always accepted by an empty buffer, however big.
+ */
+static BOOL AAHLoggingReserveBytes(uint32_t bytes) {
+    if (0 == bytes) {
+        return YES;
     }
-    _dispatchHandler = ^(GAIDispatchResult result) {
-        // Send hits until no hits are left, a dispatch error occurs, or
-        // the background task expires
-        if (result == kGAIDispatchGood && !taskExpired) {
-            [[GAI sharedInstance] dispatchWithCompletionHandler:_dispatchHandler];
-        } else {
-            // restore dispatch interval and end task
-            [self setDispatchInterval];
-            [[UIApplication sharedApplication] endBackgroundTask:taskId];
-        }
-    };
-    [[GAI sharedInstance] dispatchWithCompletionHandler:_dispatchHandler];
+    uintptr_t pendingBytes = atomic_fetch_add_explicit(&_pendingEventBytes, bytes, memory_order_relaxed);
+    if (pendingBytes > 0 && pendingBytes + bytes > _pendingMemoryLimit) {
+        atomic_fetch_sub_explicit(&_pendingEventBytes, bytes, memory_order_relaxed);
+        return NO;
+    }
+    return YES;
 }
 
-// MARK: - Private convenience methods
+/**
+ * Releases memory reserved for a queued event once it has left the buffer.
+ */
+static void AAHLoggingReleaseBytes(uint32_t bytes) {
+    if (bytes > 0) {
+        atomic_fetch_sub_explicit(&_pendingEventBytes, bytes, memory_order_relaxed);
+    }
+}
 
 /**
- * Indicates whether this is a debug build.
+ * Blocks until all events and settings queued by asynchronous logging have been passed to Firebase.
  */
-+ (BOOL)isDebugBuild {
-    #if DEBUG
-    return YES;
-    #else
-    return NO;
-    #endif
++ (void)waitForPendingEvents {
+    if (dispatch_get_specific(kLoggingQueueKey)) {
+        [self drainLoggingBuffer];
+    } else {
+        dispatch_sync(_loggingQueue, ^{
+            [self drainLoggingBuffer];
+        });
+    }
 }
 
 /**
- * Returns string representation of current timestamp.
+ * Indicates whether calls should be queued for the logging queue, either because asynchronous logging is
+ * enabled or because deferred configuration has not finished yet.
  */
-+ (NSString *)getTimestamp {
-    NSDateFormatter *dateFormatter = [[NSDateFormatter alloc] init];
-    [dateFormatter setDateFormat:@"yyyy-MM-dd HH:mm:ss.SSS 'GMT'Z '('z')'"];  // 2020-02-11 11:26:02.868 GMT-0800 (PST)
-    return [dateFormatter stringFromDate:[NSDate date]];
+static inline BOOL AAHShouldQueueCalls(void) {
+    return _asynchronousLogging || atomic_load_explicit(&_deferringConfiguration, memory_order_acquire);
 }
 
 /**
- * Returns the device's current timezone offset in hours vs GMT (e.g., -8.0, -7.0, 2.0, 1.0).
+ * Runs the block after any pending events if asynchronous logging is enabled (preserving call order), or
+ * immediately on the calling thread otherwise.
+ *
+ * @param block Work to perform.
  */
-+ (NSString *)getTimezoneOffset {
-    double offsetInHours = [[NSTimeZone localTimeZone] secondsFromGMT] / 3600.0;
-    return [NSString stringWithFormat: @"%1.1f", offsetInHours];
++ (void)performInOrder:(dispatch_block_t)block {
+    if (AAHShouldQueueCalls()) {
+        [self enqueueEventWithName:nil parameters:nil timestamp:nil journalSequence:0 block:block];
+    } else {
+        block();
+    }
+}
+
+/**
+ * Writes an event or ordered block to the logging buffer and signals the drain thread, applying the
+ * overflow policy if the buffer is full.
+ *
+ * @param name The name of the event (nil for a block).
+ * @param parameters Dictionary of event parameters (optional).
+ * @param timestamp Timestamp captured when the event was logged (nil for a block).
+ * @param journalSequence Journal record of the event (0 if not journaled).
+ * @param block Ordered work to perform instead of logging an event (optional).
+ */
++ (void)enqueueEventWithName:(nullable NSString *)name parameters:(nullable NSDictionary *)parameters timestamp:(nullable NSString *)timestamp journalSequence:(uint64_t)journalSequence block:(nullable dispatch_block_t)block {
+    // only events count against the memory cap (see setPendingMemoryLimit:)
+    uint32_t bytes = (0 == _pendingMemoryLimit || nil == name) ? 0 : AAHEstimateEventBytes(name, parameters);
+    AAHLoggingSlot *slot = NULL;
+    while (NULL == (slot = AAHLoggingReserveSlot(bytes))) {
+        atomic_store_explicit(&_isUnderBackPressure, true, memory_order_relaxed);
+        if (dispatch_get_specific(kLoggingQueueKey)) {
+            // called from the drain thread itself (e.g., from a block), so make room directly
+            [self drainLoggingBuffer];
+        } else if (AAHOverflowPolicyDropOldest == _overflowPolicy && [self dropOldestEvent]) {
+            continue;
+        } else if (AAHOverflowPolicyDropOldest == _overflowPolicy && nil != name) {
+            // the oldest entry is a setting, which is never dropped, so drop the new event instead
+            AAHJournalCheckpoint(journalSequence);
+            atomic_fetch_add_explicit(&_droppedEventCount, 1, memory_order_relaxed);
+            return;
+        } else {
+            // wait for the drain thread, which signals once for each entry it takes while producers are waiting;
+            // the slot is claimed again after registering, so room made in between isn't missed
+            atomic_fetch_add_explicit(&_loggingBlockedProducers, 1, memory_order_seq_cst);
+            atomic_thread_fence(memory_order_seq_cst);
+            if (NULL == (slot = AAHLoggingReserveSlot(bytes))) {
+                dispatch_source_merge_data(_loggingDrainSource, 1);
+                dispatch_semaphore_wait(_loggingSpaceSemaphore, DISPATCH_TIME_FOREVER);
+            }
+            atomic_fetch_sub_explicit(&_loggingBlockedProducers, 1, memory_order_relaxed);
+            if (NULL != slot) {
+                break;
+            }
+        }
+    }
+    slot->name = (__bridge_retained void *)name;
+    slot->parameters = (__bridge_retained void *)parameters;
+    slot->timestamp = (__bridge_retained void *)timestamp;
+    slot->block = (__bridge_retained void *)[block copy];
+    slot->journalSequence = journalSequence;
+    slot->bytes = bytes;
+    AAHLoggingPublishSlot(slot);
+    dispatch_source_merge_data(_loggingDrainSource, 1);
+}
+
+/**
+ * Claims the next free slot for writing, or returns NULL if the buffer is full. Lock-free for any number of producers.
+ */
+static AAHLoggingSlot *AAHLoggingClaimSlot(void) {
+    uintptr_t position = atomic_load_explicit(&_loggingEnqueuePosition, memory_order_relaxed);
+    for (;;) {
+        AAHLoggingSlot *slot = &_loggingSlots[position & (kLoggingBufferCapacity - 1)];
+        intptr_t difference = (intptr_t)atomic_load_explicit(&slot->sequence, memory_order_acquire) - (intptr_t)position;
+        if (0 == difference) {
+            if (atomic_compare_exchange_weak_explicit(&_loggingEnqueuePosition, &position, position + 1, memory_order_relaxed, memory_order_relaxed)) {
+                return slot;
+            }
+        } else if (difference < 0) {
+            return NULL;
+        } else {
+            position = atomic_load_explicit(&_loggingEnqueuePosition, memory_order_relaxed);
+        }
+    }
+}
+
+/**
+ * Reserves memory under the memory cap and claims a slot for an entry, or returns NULL if either is exhausted.
+ */
+static AAHLoggingSlot *AAHLoggingReserveSlot(uint32_t bytes) {
+    if (!AAHLoggingReserveBytes(bytes)) {
+        return NULL;
+    }
+    AAHLoggingSlot *slot = AAHLoggingClaimSlot();
+    if (NULL == slot) {
+        AAHLoggingReleaseBytes(bytes);
+    }
+    return slot;
+}
+
+/**
+ * Marks a claimed slot as full, making it visible to the consumer.
+ */
+static void AAHLoggingPublishSlot(AAHLoggingSlot *slot) {
+    uintptr_t position = atomic_load_explicit(&slot->sequence, memory_order_relaxed);
+    atomic_store_explicit(&slot->sequence, position + 1, memory_order_release);
+}
+
+/**
+ * Takes the oldest full slot's contents, or returns NO if the buffer is empty (or, if eventsOnly is set,
+ * if the oldest entry is a block).
+ *
+ * The drain thread is the only regular consumer, but producers also take events under the drop-oldest
+ * overflow policy, so taking an entry is lock-free for multiple consumers as well.
+ */
+static BOOL AAHLoggingTakeEntry(AAHLoggingSlot *entry, BOOL eventsOnly) {
+    uintptr_t position = atomic_load_explicit(&_loggingDequeuePosition, memory_order_relaxed);
+    for (;;) {
+        AAHLoggingSlot *slot = &_loggingSlots[position & (kLoggingBufferCapacity - 1)];
+        intptr_t difference = (intptr_t)atomic_load_explicit(&slot->sequence, memory_order_acquire) - (intptr_t)(position + 1);
+        if (0 == difference) {
+            // the slot is only read as this position's entry if the exchange below succeeds
+            if (eventsOnly && NULL != slot->block) {
+                return NO;
+            }
+            if (atomic_compare_exchange_weak_explicit(&_loggingDequeuePosition, &position, position + 1, memory_order_relaxed, memory_order_relaxed)) {
+                entry->name = slot->name;
+                entry->parameters = slot->parameters;
+                entry->timestamp = slot->timestamp;
+                entry->block = slot->block;
+                entry->journalSequence = slot->journalSequence;
+                entry->bytes = slot->bytes;
+                atomic_store_explicit(&slot->sequence, position + kLoggingBufferCapacity, memory_order_release);
+                return YES;
+            }
+        } else if (difference < 0) {
+            return NO;
+        } else {
+            position = atomic_load_explicit(&_loggingDequeuePosition, memory_order_relaxed);
+        }
+    }
+}
+
+/**
+ * Makes room in a full buffer by discarding its oldest entry, if that entry is an event (drop-oldest overflow policy).
+ *
+ * Settings and batches are never dropped, and never performed by producers, which would run them concurrently
+ * with (and ahead of) the entries the drain thread is still processing. So nothing is taken if the oldest entry
+ * is a block.
+ *
+ * @return True if an event was dropped.
+ */
++ (BOOL)dropOldestEvent {
+    AAHLoggingSlot entry;
+    if (!AAHLoggingTakeEntry(&entry, YES)) {
+        return NO;
+    }
+    __unused NSString *name = (__bridge_transfer NSString *)entry.name;
+    __unused NSDictionary *parameters = (__bridge_transfer NSDictionary *)entry.parameters;
+    __unused NSString *timestamp = (__bridge_transfer NSString *)entry.timestamp;
+    AAHLoggingReleaseBytes(entry.bytes);
+    
+    // dropped by policy, so don't replay it on the next launch either
+    AAHJournalCheckpoint(entry.journalSequence);
+    atomic_fetch_add_explicit(&_droppedEventCount, 1, memory_order_relaxed);
+    return YES;
+}
+
+/**
+ * Validates and passes every buffered event to Firebase, and performs every buffered block, in order.
+ *
+ * Temporaries (prepared dictionaries, truncated strings, etc.) are released together for each batch of
+ * kLoggingDrainBatchSize entries, which keeps peak memory flat without the cost of a pool per entry.
+ *
+ * Runs on the logging queue.
+ */
++ (void)drainLoggingBuffer {
+    AAHLoggingSlot entry;
+    BOOL isDrained = NO;
+    while (!isDrained) {
+        @autoreleasepool {
+            for (NSUInteger i = 0; i < kLoggingDrainBatchSize && !isDrained; i++) {
+                if (!AAHLoggingTakeEntry(&entry, NO)) {
+                    isDrained = YES;
+                    break;
+                }
+                dispatch_block_t block = (__bridge_transfer dispatch_block_t)entry.block;
+                NSString *name = (__bridge_transfer NSString *)entry.name;
+                NSDictionary *parameters = (__bridge_transfer NSDictionary *)entry.parameters;
+                NSString *timestamp = (__bridge_transfer NSString *)entry.timestamp;
+                AAHLoggingReleaseBytes(entry.bytes);
+                
+                // wake producers waiting for room (block overflow policy)
+                atomic_thread_fence(memory_order_seq_cst);
+                if (atomic_load_explicit(&_loggingBlockedProducers, memory_order_relaxed) > 0) {
+                    dispatch_semaphore_signal(_loggingSpaceSemaphore);
+                }
+                
+                if (nil != block) {
+                    block();
+                } else {
+                    [self processEventWithName:name parameters:parameters timestamp:timestamp journalSequence:entry.journalSequence];
+                }
+            }
+        }
+    }
+    atomic_store_explicit(&_isUnderBackPressure, false, memory_order_relaxed);
+}
+
+// MARK: - Event journal
+
+/**
+ * Size of each journal record and of the journal header page, in bytes. Records are page-sized so that
+ * appending a record touches a single page of the mapping.
+ */
+#define kJournalRecordSize 4096
+
+/** Number of records in the journal (i.e., the most events that can await Firebase at once). */
+#define kJournalRecordCount 256
+
+/** Identifies the journal file format. */
+static const uint32_t kJournalMagic = 0x4A484141; // "AAHJ"
+static const uint32_t kJournalVersion = 2;
+
+/** Journal record states. */
+typedef NS_ENUM(uint32_t, AAHJournalRecordState) {
+    AAHJournalRecordStateFree,      // empty, or checkpointed once Firebase accepted the event
+    AAHJournalRecordStatePending,   // written when the event entered the helper, not yet accepted by Firebase
+    AAHJournalRecordStateWriting    // claimed by an append that hasn't finished writing it
+};
+
+/** Journal value types (each parameter value is stored as a type byte followed by the value). */
+typedef NS_ENUM(uint8_t, AAHJournalValueType) {
+    AAHJournalValueTypeString = 1,  // uint16 length + UTF-8 bytes
+    AAHJournalValueTypeInteger,     // int64
+    AAHJournalValueTypeDouble,      // double
+    AAHJournalValueTypeItems        // uint16 count + nested parameter lists
+};
+
+/**
+ * Header stored in the first page of the journal file. Records store seeded names by ID, so the journal
+ * is only replayed if the seeded names are unchanged (see AAHSeedInternTable).
+ */
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t recordSize;
+    uint32_t recordCount;
+    uint32_t seededNameCount;
+    uint32_t seededNameChecksum;
+} AAHJournalHeader;
+
+/** Flag marking a name stored as an interned ID (the low bits), rather than as a length followed by UTF-8 bytes. */
+static const uint16_t kJournalNameIDFlag = 0x8000;
+
+/**
+ * Fixed-size journal record. The payload holds the event name, the timestamp (a uint16 length plus UTF-8
+ * bytes), and the parameter list (a uint16 count, then each parameter's name and value). Event and parameter
+ * names are stored as a uint16 interned ID when they are seeded names, or as a uint16 length plus UTF-8 bytes.
+ */
+typedef struct {
+    _Atomic(uint32_t) state;
+    uint32_t length;
+    uint64_t sequence;
+    uint8_t payload[kJournalRecordSize - 16];
+} AAHJournalRecord;
+
+/** Private class variables for the event journal (see setEventJournalEnabled: below). */
+static BOOL _journalEnabled = NO;
+static AAHJournalRecord *_journalRecords = NULL;
+static _Atomic(uint64_t) _journalSequence;
+static _Atomic(uint64_t) _journalSkippedCount;     // events not journaled because their record was still pending
+
+/** Bounds-checked cursor for encoding or decoding a record payload. */
+typedef struct {
+    uint8_t *cursor;
+    uint8_t *end;
+} AAHJournalCursor;
+
+/**
+ * Controls whether events are written to an on-disk journal as they enter the helper, so that events not yet
+ * accepted by Firebase when the process is killed are logged on the next launch. Default is false.
+ *
+ * Appending an event encodes it directly into a memory-mapped, fixed-size record, with no allocation or fsync;
+ * the kernel writes the page to disk even if the app is killed. Events with parameter values other than strings,
+ * numbers, and items arrays, or that don't fit in a record, are logged but not journaled. Must be called before
+ * configure, which replays any events left over from the previous launch.
+ *
+ * Note that this only covers the hand-off to Firebase. GA360 hits are generated and persisted downstream by
+ * GTM and the GA library, which this helper cannot journal.
+ *
+ * @param enable True to journal events.
+ */
++ (void)setEventJournalEnabled:(BOOL)enable {
+    _journalEnabled = enable;
+}
+
+/**
+ * Returns the number of events logged but not journaled because their record still held an event Firebase
+ * hadn't accepted (more than kJournalRecordCount journaled events in flight).
+ */
++ (NSUInteger)unjournaledEventCount {
+    return (NSUInteger)atomic_load_explicit(&_journalSkippedCount, memory_order_relaxed);
+}
+
+/**
+ * Maps the journal file into memory, creating it if needed.
+ *
+ * @return Events left pending by the previous launch, in the order they were logged.
+ */
++ (nonnull NSArray<NSDictionary *> *)openEventJournal {
+    NSURL *directory = [[[NSFileManager defaultManager] URLsForDirectory:NSApplicationSupportDirectory inDomains:NSUserDomainMask] firstObject];
+    directory = [directory URLByAppendingPathComponent:@"AAHAnalyticsHelper" isDirectory:YES];
+    [[NSFileManager defaultManager] createDirectoryAtURL:directory withIntermediateDirectories:YES attributes:nil error:nil];
+    const char *path = [directory URLByAppendingPathComponent:@"events.journal"].fileSystemRepresentation;
+    
+    size_t size = (size_t)kJournalRecordSize * (kJournalRecordCount + 1);
+    int file = open(path, O_RDWR | O_CREAT, 0600);
+    if (file < 0 || ftruncate(file, (off_t)size) != 0) {
+        if (file >= 0) {
+            close(file);
+        }
+        return @[];
+    }
+    void *mapping = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+    close(file);
+    if (MAP_FAILED == mapping) {
+        return @[];
+    }
+    
+    AAHJournalHeader *header = mapping;
+    AAHJournalRecord *records = (AAHJournalRecord *)((uint8_t *)mapping + kJournalRecordSize);
+    if (header->magic != kJournalMagic || header->version != kJournalVersion ||
+        header->recordSize != kJournalRecordSize || header->recordCount != kJournalRecordCount ||
+        header->seededNameCount != _internSeededCount || header->seededNameChecksum != _internSeedChecksum) {
+        // new file, or written by a different version of the helper
+        memset(mapping, 0, size);
+        *header = (AAHJournalHeader){kJournalMagic, kJournalVersion, kJournalRecordSize, kJournalRecordCount, _internSeededCount, _internSeedChecksum};
+    }
+    
+    // collect pending records, oldest first
+    NSMutableArray<NSDictionary *> *pending = [NSMutableArray array];
+    uint64_t lastSequence = 0;
+    for (NSUInteger i = 0; i < kJournalRecordCount; i++) {
+        AAHJournalRecord *record = &records[i];
+        lastSequence = MAX(lastSequence, record->sequence);
+        if (AAHJournalRecordStatePending != atomic_load_explicit(&record->state, memory_order_relaxed)) {
+            // also releases records whose append was cut short when the previous launch ended
+            atomic_store_explicit(&record->state, AAHJournalRecordStateFree, memory_order_relaxed);
+            continue;
+        }
+        AAHJournalCursor reader = {record->payload, record->payload + MIN(record->length, sizeof(record->payload))};
+        NSString *name = AAHJournalGetName(&reader);
+        NSString *timestamp = AAHJournalGetString(&reader);
+        NSDictionary *parameters = AAHJournalGetParameters(&reader, 0);
+        if (nil != name && nil != timestamp && nil != parameters) {
+            [pending addObject:@{@"name": name, @"parameters": parameters, @"timestamp": timestamp, @"sequence": @(record->sequence)}];
+        } else {
+            atomic_store_explicit(&record->state, AAHJournalRecordStateFree, memory_order_relaxed);
+        }
+    }
+    [pending sortUsingDescriptors:@[[NSSortDescriptor sortDescriptorWithKey:@"sequence" ascending:YES]]];
+    
+    atomic_store_explicit(&_journalSequence, lastSequence, memory_order_relaxed);
+    _journalRecords = records;
+    return pending;
+}
+
+/**
+ * Logs events left pending in the journal by the previous launch, with their original timestamps, and
+ * checkpoints them once Firebase has accepted them.
+ *
+ * @param pending Events returned by openEventJournal.
+ */
++ (void)replayEventJournal:(nonnull NSArray<NSDictionary *> *)pending {
+    if (0 == pending.count) {
+        return;
+    }
+    // replay as one batch, so a long backlog is prepared in parallel (see processEvents:timestamps:journalSequences:)
+    NSMutableArray<AAHAnalyticsEvent *> *events = [NSMutableArray arrayWithCapacity:pending.count];
+    NSMutableArray<NSString *> *timestamps = [NSMutableArray arrayWithCapacity:pending.count];
+    NSMutableData *journalSequences = [NSMutableData dataWithLength:pending.count * sizeof(uint64_t)];
+    uint64_t *sequences = journalSequences.mutableBytes;
+    [pending enumerateObjectsUsingBlock:^(NSDictionary *event, NSUInteger i, BOOL *stop) {
+        [events addObject:[AAHAnalyticsEvent eventWithName:event[@"name"] parameters:event[@"parameters"]]];
+        [timestamps addObject:event[@"timestamp"]];
+        sequences[i] = [event[@"sequence"] unsignedLongLongValue];
+    }];
+    [self performInOrder:^{
+        [self processEvents:events timestamps:timestamps journalSequences:journalSequences];
+    }];
+}
+
+/* Payload encoding/decoding helpers. Each fails (NO/nil) rather than reading or writing past the end of a record. */
+
+static BOOL AAHJournalPutBytes(AAHJournalCursor *writer, const void *bytes, size_t length) {
+    if ((size_t)(writer->end - writer->cursor) < length) {
+        return NO;
+    }
+    memcpy(writer->cursor, bytes, length);
+    writer->cursor += length;
+    return YES;
+}
+
+static BOOL AAHJournalPutString(AAHJournalCursor *writer, NSString *string, size_t maxLength) {
+    // encode directly into the record, after room for the length prefix
+    uint8_t *lengthPointer = writer->cursor;
+    if (writer->end - writer->cursor < (ptrdiff_t)sizeof(uint16_t)) {
+        return NO;
+    }
+    NSUInteger usedLength = 0;
+    NSRange remaining = {0, 0};
+    size_t available = MIN((size_t)(writer->end - writer->cursor) - sizeof(uint16_t), maxLength);
+    [string getBytes:lengthPointer + sizeof(uint16_t) maxLength:available usedLength:&usedLength encoding:NSUTF8StringEncoding options:0 range:NSMakeRange(0, string.length) remainingRange:&remaining];
+    if (remaining.length > 0) {
+        return NO;
+    }
+    uint16_t length = (uint16_t)usedLength;
+    memcpy(lengthPointer, &length, sizeof(length));
+    writer->cursor += sizeof(length) + usedLength;
+    return YES;
+}
+
+static BOOL AAHJournalPutName(AAHJournalCursor *writer, NSString *name) {
+    AAHNameID nameID = AAHFindName(name, name.hash);
+    if (kAAHNameIDNone != nameID && nameID <= _internSeededCount) {
+        uint16_t tag = kJournalNameIDFlag | nameID;
+        return AAHJournalPutBytes(writer, &tag, sizeof(tag));
+    }
+    return AAHJournalPutString(writer, name, kJournalNameIDFlag - 1);
+}
+
+static BOOL AAHJournalPutParameters(AAHJournalCursor *writer, NSDictionary *parameters, NSUInteger depth) {
+    uint16_t count = (uint16_t)MIN(parameters.count, (NSUInteger)UINT16_MAX);
+    if (!AAHJournalPutBytes(writer, &count, sizeof(count))) {
+        return NO;
+    }
+    __block BOOL isEncoded = YES;
+    [parameters enumerateKeysAndObjectsUsingBlock:^(NSString *key, id value, BOOL *stop) {
+        uint8_t type = 0;
+        if ([value isKindOfClass:[NSString class]]) {
+            type = AAHJournalValueTypeString;
+            isEncoded = AAHJournalPutName(writer, key) && AAHJournalPutBytes(writer, &type, 1) && AAHJournalPutString(writer, value, UINT16_MAX);
+        } else if ([value isKindOfClass:[NSNumber class]]) {
+            if (CFNumberIsFloatType((__bridge CFNumberRef)value)) {
+                type = AAHJournalValueTypeDouble;
+                double number = [value doubleValue];
+                isEncoded = AAHJournalPutName(writer, key) && AAHJournalPutBytes(writer, &type, 1) && AAHJournalPutBytes(writer, &number, sizeof(number));
+            } else {
+                type = AAHJournalValueTypeInteger;
+                int64_t number = [value longLongValue];
+                isEncoded = AAHJournalPutName(writer, key) && AAHJournalPutBytes(writer, &type, 1) && AAHJournalPutBytes(writer, &number, sizeof(number));
+            }
+        } else if (0 == depth && [value isKindOfClass:[NSArray class]]) {
+            type = AAHJournalValueTypeItems;
+            uint16_t itemCount = (uint16_t)MIN([value count], (NSUInteger)UINT16_MAX);
+            isEncoded = AAHJournalPutName(writer, key) && AAHJournalPutBytes(writer, &type, 1) && AAHJournalPutBytes(writer, &itemCount, sizeof(itemCount));
+            for (NSUInteger i = 0; isEncoded && i < itemCount; i++) {
+                id item = value[i];
+                isEncoded = [item isKindOfClass:[NSDictionary class]] && AAHJournalPutParameters(writer, item, depth + 1);
+            }
+        } else {
+            // not representable in the journal
+            isEncoded = NO;
+        }
+        *stop = !isEncoded;
+    }];
+    return isEncoded;
+}
+
+static BOOL AAHJournalGetBytes(AAHJournalCursor *reader, void *bytes, size_t length) {
+    if ((size_t)(reader->end - reader->cursor) < length) {
+        return NO;
+    }
+    memcpy(bytes, reader->cursor, length);
+    reader->cursor += length;
+    return YES;
+}
+
+static NSString *AAHJournalGetString(AAHJournalCursor *reader) {
+    uint16_t length = 0;
+    if (!AAHJournalGetBytes(reader, &length, sizeof(length)) || reader->end - reader->cursor < length) {
+        return nil;
+    }
+    NSString *string = [[NSString alloc] initWithBytes:reader->cursor length:length encoding:NSUTF8StringEncoding];
+    reader->cursor += length;
+    return string;
+}
+
+static NSString *AAHJournalGetName(AAHJournalCursor *reader) {
+    uint16_t tag = 0;
+    if (reader->end - reader->cursor < (ptrdiff_t)sizeof(tag)) {
+        return nil;
+    }
+    memcpy(&tag, reader->cursor, sizeof(tag));
+    if (0 == (tag & kJournalNameIDFlag)) {
+        return AAHJournalGetString(reader);
+    }
+    reader->cursor += sizeof(tag);
+    AAHNameID nameID = tag & ~kJournalNameIDFlag;
+    return (nameID <= _internSeededCount) ? AAHInternedName(nameID) : nil;
+}
+
+static NSDictionary *AAHJournalGetParameters(AAHJournalCursor *reader, NSUInteger depth) {
+    uint16_t count = 0;
+    if (!AAHJournalGetBytes(reader, &count, sizeof(count))) {
+        return nil;
+    }
+    NSMutableDictionary *parameters = [NSMutableDictionary dictionaryWithCapacity:count];
+    for (uint16_t i = 0; i < count; i++) {
+        NSString *key = AAHJournalGetName(reader);
+        uint8_t type = 0;
+        if (nil == key || !AAHJournalGetBytes(reader, &type, 1)) {
+            return nil;
+        }
+        id value = nil;
+        switch (type) {
+            case AAHJournalValueTypeString:
+                value = AAHJournalGetString(reader);
+                break;
+            case AAHJournalValueTypeInteger: {
+                int64_t number = 0;
+                value = AAHJournalGetBytes(reader, &number, sizeof(number)) ? @(number) : nil;
+                break;
+            }
+            case AAHJournalValueTypeDouble: {
+                double number = 0;
+                value = AAHJournalGetBytes(reader, &number, sizeof(number)) ? @(number) : nil;
+                break;
+            }
+            case AAHJournalValueTypeItems: {
+                uint16_t itemCount = 0;
+                if (0 == depth && AAHJournalGetBytes(reader, &itemCount, sizeof(itemCount))) {
+                    NSMutableArray *items = [NSMutableArray arrayWithCapacity:itemCount];
+                    for (uint16_t j = 0; j < itemCount; j++) {
+                        NSDictionary *item = AAHJournalGetParameters(reader, depth + 1);
+                        if (nil == item) {
+                            return nil;
+                        }
+                        [items addObject:item];
+                    }
+                    value = items;
+                }
+                break;
+            }
+        }
+        if (nil == value) {
+            return nil;
+        }
+        parameters[key] = value;
+    }
+    return parameters;
+}
+
+/**
+ * Appends an event to the journal as it enters the helper.
+ *
+ * @return Sequence number identifying the record (to pass to AAHJournalCheckpoint), or 0 if the event was not journaled.
+ */
+static uint64_t AAHJournalAppend(NSString *name, NSDictionary *parameters, NSString *timestamp) {
+    if (NULL == _journalRecords) {
+        return 0;
+    }
+    uint64_t sequence = atomic_fetch_add_explicit(&_journalSequence, 1, memory_order_relaxed) + 1;
+    AAHJournalRecord *record = &_journalRecords[sequence % kJournalRecordCount];
+    
+    // claim the record, so no other append or checkpoint touches it while it's written; if it still holds
+    // an event Firebase hasn't accepted (more than kJournalRecordCount events in flight), that event is
+    // kept and this one isn't journaled
+    uint32_t expected = AAHJournalRecordStateFree;
+    if (!atomic_compare_exchange_strong_explicit(&record->state, &expected, AAHJournalRecordStateWriting, memory_order_acquire, memory_order_relaxed)) {
+        atomic_fetch_add_explicit(&_journalSkippedCount, 1, memory_order_relaxed);
+        return 0;
+    }
+    AAHJournalCursor writer = {record->payload, record->payload + sizeof(record->payload)};
+    if (!AAHJournalPutName(&writer, name) || !AAHJournalPutString(&writer, timestamp, UINT16_MAX) || !AAHJournalPutParameters(&writer, parameters, 0)) {
+        atomic_store_explicit(&record->state, AAHJournalRecordStateFree, memory_order_release);
+        return 0;
+    }
+    record->length = (uint32_t)(writer.cursor - record->payload);
+    record->sequence = sequence;
+    atomic_store_explicit(&record->state, AAHJournalRecordStatePending, memory_order_release);
+    return sequence;
+}
+
+/**
+ * Marks a journaled event as accepted by Firebase, so it isn't replayed on the next launch.
+ *
+ * @param sequence Sequence number returned by AAHJournalAppend (0 does nothing).
+ */
+static void AAHJournalCheckpoint(uint64_t sequence) {
+    if (0 == sequence || NULL == _journalRecords) {
+        return;
+    }
+    AAHJournalRecord *record = &_journalRecords[sequence % kJournalRecordCount];
+    
+    // a pending record is only rewritten once it has been checkpointed, so its sequence is stable here
+    uint32_t expected = AAHJournalRecordStatePending;
+    if (AAHJournalRecordStatePending == atomic_load_explicit(&record->state, memory_order_acquire) && record->sequence == sequence) {
+        atomic_compare_exchange_strong_explicit(&record->state, &expected, AAHJournalRecordStateFree, memory_order_release, memory_order_relaxed);
+    }
+}
+
+// MARK: - Trace recording and replay
+
+/** Identifies the trace file format. */
+static const uint32_t kTraceMagic = 0x54484141; // "AAHT"
+static const uint32_t kTraceVersion = 1;
+
+/** Size of the in-memory trace buffer written to the file at once. */
+static const NSUInteger kTraceFlushSize = 64 * 1024;
+
+/** Calls captured in a trace. */
+typedef NS_ENUM(uint8_t, AAHTraceCallKind) {
+    AAHTraceCallLogEvent = 1,               // event name + parameter list
+    AAHTraceCallSetUserProperty,            // user property name + value
+    AAHTraceCallSetUserID,                  // user ID
+    AAHTraceCallSetDefaultEventParameters   // parameter list
+};
+
+/** Flag marking a call whose (nullable) value or parameters were passed, rather than nil. */
+static const uint8_t kTraceHasValueFlag = 0x01;
+
+/**
+ * Header at the start of a trace file. Names are encoded as in the event journal (seeded names by ID), so a
+ * trace is only replayed by a build with the same seeded names.
+ */
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t seededNameCount;
+    uint32_t seededNameChecksum;
+} AAHTraceHeader;
+
+/** Header of each call in a trace, followed by a payload of the given length, encoded as in the event journal. */
+typedef struct {
+    uint64_t offset;    // nanoseconds since recording started
+    uint32_t length;
+    uint8_t kind;
+    uint8_t flags;
+    uint16_t reserved;
+} AAHTraceCallHeader;
+
+/** Private class variables for trace recording (see startTraceRecordingToURL: below). */
+static _Atomic(bool) _isRecordingTrace;
+static int _traceFile = -1;
+static uint64_t _traceStartTime = 0;
+static NSMutableData *_traceBuffer = nil;
+static dispatch_queue_t _traceQueue = nil;
+static os_unfair_lock _traceLock = OS_UNFAIR_LOCK_INIT;
+
+/**
+ * Starts recording every call to logEventWithName:parameters:, setUserPropertyString:forName:, setUserID:, and
+ * setDefaultEventParameters: (with its time) to a compact binary trace file, for replayTraceAtURL:speed:.
+ *
+ * Calls are encoded on the calling thread into a memory buffer, which is written to the file in 64 KB blocks on a
+ * background queue. Calls with parameter values other than strings, numbers, and items arrays, or bigger than a
+ * journal record, are not recorded. Intended for test builds: the trace holds every value passed to the helper.
+ *
+ * @param url File URL of the trace (replaced if it exists).
+ * @return False if the file could not be created.
+ */
++ (BOOL)startTraceRecordingToURL:(nonnull NSURL *)url {
+    [self stopTraceRecording];
+    int file = open(url.fileSystemRepresentation, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    if (file < 0) {
+        return NO;
+    }
+    AAHTraceHeader header = {kTraceMagic, kTraceVersion, _internSeededCount, _internSeedChecksum};
+    if (write(file, &header, sizeof(header)) != (ssize_t)sizeof(header)) {
+        close(file);
+        return NO;
+    }
+    if (nil == _traceQueue) {
+        dispatch_queue_attr_t attributes = dispatch_queue_attr_make_with_qos_class(DISPATCH_QUEUE_SERIAL, QOS_CLASS_UTILITY, 0);
+        _traceQueue = dispatch_queue_create("com.adswerve.AAHAnalyticsHelper.trace", attributes);
+    }
+    os_unfair_lock_lock(&_traceLock);
+    _traceFile = file;
+    _traceStartTime = clock_gettime_nsec_np(CLOCK_UPTIME_RAW);
+    _traceBuffer = [NSMutableData dataWithCapacity:kTraceFlushSize];
+    atomic_store_explicit(&_isRecordingTrace, true, memory_order_release);
+    os_unfair_lock_unlock(&_traceLock);
+    return YES;
+}
+
+/**
+ * Stops recording calls (see startTraceRecordingToURL:), and blocks until the trace file is complete.
+ */
++ (void)stopTraceRecording {
+    os_unfair_lock_lock(&_traceLock);
+    atomic_store_explicit(&_isRecordingTrace, false, memory_order_relaxed);
+    NSData *remaining = _traceBuffer;
+    int file = _traceFile;
+    _traceBuffer = nil;
+    _traceFile = -1;
+    os_unfair_lock_unlock(&_traceLock);
+    if (file < 0) {
+        return;
+    }
+    dispatch_sync(_traceQueue, ^{
+        AAHTraceWrite(file, remaining);
+        close(file);
+    });
+}
+
+/**
+ * Indicates whether calls are being recorded to a trace (one relaxed load on the calling thread).
+ */
+static inline BOOL AAHIsRecordingTrace(void) {
+    return atomic_load_explicit(&_isRecordingTrace, memory_order_relaxed);
+}
+
+/**
+ * Writes a block of the trace to the file. Runs on the trace queue.
+ */
+static void AAHTraceWrite(int file, NSData *data) {
+    const uint8_t *bytes = data.bytes;
+    size_t remaining = data.length;
+    while (remaining > 0) {
+        ssize_t written = write(file, bytes, remaining);
+        if (written <= 0) {
+            return;
+        }
+        bytes += written;
+        remaining -= (size_t)written;
+    }
+}
+
+/**
+ * Records a call to the trace, if recording. The name, value, and parameters are encoded as in the event journal.
+ *
+ * @param kind The kind of call.
+ * @param name Event or user property name (nil for other calls).
+ * @param value User property value or user ID (optional).
+ * @param parameters Event or default event parameters (optional).
+ */
+static void AAHTraceRecordCall(AAHTraceCallKind kind, NSString *name, NSString *value, NSDictionary *parameters) {
+    uint64_t now = clock_gettime_nsec_np(CLOCK_UPTIME_RAW);
+    uint8_t payload[kJournalRecordSize];
+    AAHJournalCursor writer = {payload, payload + sizeof(payload)};
+    BOOL hasValue = NO;
+    BOOL isEncoded = YES;
+    switch (kind) {
+        case AAHTraceCallLogEvent:
+            hasValue = (nil != parameters);
+            isEncoded = AAHJournalPutName(&writer, name) && AAHJournalPutParameters(&writer, parameters, 0);
+            break;
+        case AAHTraceCallSetUserProperty:
+            hasValue = (nil != value);
+            isEncoded = AAHJournalPutName(&writer, name) && (!hasValue || AAHJournalPutString(&writer, value, UINT16_MAX));
+            break;
+        case AAHTraceCallSetUserID:
+            hasValue = (nil != value);
+            isEncoded = !hasValue || AAHJournalPutString(&writer, value, UINT16_MAX);
+            break;
+        case AAHTraceCallSetDefaultEventParameters:
+            hasValue = (nil != parameters);
+            isEncoded = AAHJournalPutParameters(&writer, parameters, 0);
+            break;
+    }
+    if (!isEncoded) {
+        return;
+    }
+    
+    // append to the buffer, handing full blocks to the trace queue
+    os_unfair_lock_lock(&_traceLock);
+    if (nil != _traceBuffer) {
+        AAHTraceCallHeader header = {now - MIN(now, _traceStartTime), (uint32_t)(writer.cursor - payload), kind, hasValue ? kTraceHasValueFlag : 0, 0};
+        [_traceBuffer appendBytes:&header length:sizeof(header)];
+        [_traceBuffer appendBytes:payload length:header.length];
+        if (_traceBuffer.length >= kTraceFlushSize) {
+            NSData *block = _traceBuffer;
+            int file = _traceFile;
+            _traceBuffer = [NSMutableData dataWithCapacity:kTraceFlushSize];
+            dispatch_async(_traceQueue, ^{
+                AAHTraceWrite(file, block);
+            });
+        }
+    }
+    os_unfair_lock_unlock(&_traceLock);
+}
+
+/**
+ * Replays a trace recorded by startTraceRecordingToURL: against the helper, as currently configured, and
+ * measures it. Blocks until the replayed events have been passed to Firebase (call it from a background thread).
+ *
+ * To measure the helper alone, disable collection first (setAnalyticsCollectionEnabled:NO), so Firebase
+ * discards the replayed events, and stop any trace recording, so the replay isn't recorded itself.
+ *
+ * Keys of the result: "call_count", "duration_ms", "calls_per_second", "p50_latency_us", "p99_latency_us" and
+ * "max_latency_us" (time spent in each call on the calling thread), "dropped_events" (by the logging buffer,
+ * sampling, or rate limiting), and "footprint_growth_bytes" (change in the app's memory footprint).
+ *
+ * @param url File URL of the trace.
+ * @param speed Replay speed relative to the recording (e.g., 1.0 or 10.0), or 0 to replay as fast as possible.
+ * @return Measurements of the replay, or nil if the trace could not be read (or memory for the measurements could not be allocated).
+ */
++ (nullable NSDictionary<NSString *, NSNumber *> *)replayTraceAtURL:(nonnull NSURL *)url speed:(double)speed {
+    NSData *trace = [NSData dataWithContentsOfURL:url options:NSDataReadingMappedIfSafe error:nil];
+    const AAHTraceHeader *header = trace.bytes;
+    if (trace.length < sizeof(AAHTraceHeader) || header->magic != kTraceMagic || header->version != kTraceVersion ||
+        header->seededNameCount != _internSeededCount || header->seededNameChecksum != _internSeedChecksum) {
+        return nil;
+    }
+    
+    // decode every call up front, so decoding isn't measured
+    NSMutableArray<dispatch_block_t> *calls = [NSMutableArray array];
+    NSMutableData *offsets = [NSMutableData data];
+    AAHJournalCursor reader = {(uint8_t *)trace.bytes + sizeof(AAHTraceHeader), (uint8_t *)trace.bytes + trace.length};
+    AAHTraceCallHeader callHeader;
+    while (AAHJournalGetBytes(&reader, &callHeader, sizeof(callHeader)) && (size_t)(reader.end - reader.cursor) >= callHeader.length) {
+        AAHJournalCursor payload = {reader.cursor, reader.cursor + callHeader.length};
+        reader.cursor += callHeader.length;
+        BOOL hasValue = (0 != (callHeader.flags & kTraceHasValueFlag));
+        dispatch_block_t call = nil;
+        switch (callHeader.kind) {
+            case AAHTraceCallLogEvent: {
+                NSString *name = AAHJournalGetName(&payload);
+                NSDictionary *parameters = AAHJournalGetParameters(&payload, 0);
+                if (nil != name && nil != parameters) {
+                    call = ^{ [self logEventWithName:name parameters:hasValue ? parameters : nil]; };
+                }
+                break;
+            }
+            case AAHTraceCallSetUserProperty: {
+                NSString *name = AAHJournalGetName(&payload);
+                NSString *value = hasValue ? AAHJournalGetString(&payload) : nil;
+                if (nil != name && (nil != value || !hasValue)) {
+                    call = ^{ [self setUserPropertyString:value forName:name]; };
+                }
+                break;
+            }
+            case AAHTraceCallSetUserID: {
+                NSString *userID = hasValue ? AAHJournalGetString(&payload) : nil;
+                if (nil != userID || !hasValue) {
+                    call = ^{ [self setUserID:userID]; };
+                }
+                break;
+            }
+            case AAHTraceCallSetDefaultEventParameters: {
+                NSDictionary *parameters = AAHJournalGetParameters(&payload, 0);
+                if (nil != parameters) {
+                    call = ^{ [self setDefaultEventParameters:hasValue ? parameters : nil]; };
+                }
+                break;
+            }
+        }
+        if (nil != call) {
+            [calls addObject:call];
+            [offsets appendBytes:&callHeader.offset length:sizeof(callHeader.offset)];
+        }
+    }
+    NSUInteger count = calls.count;
+    if (0 == count) {
+        return nil;
+    }
+    
+    // replay, pacing calls by their recorded offsets (unless replaying as fast as possible)
+    const uint64_t *callOffsets = offsets.bytes;
+    uint64_t *latencies = calloc(count, sizeof(uint64_t));
+    if (NULL == latencies) {
+        return nil;
+    }
+    uint64_t droppedBefore = AAHReplayDroppedEventCount();
+    int64_t footprintBefore = AAHReplayFootprint();
+    uint64_t start = clock_gettime_nsec_np(CLOCK_UPTIME_RAW);
+    for (NSUInteger i = 0; i < count; i++) {
+        if (speed > 0) {
+            uint64_t target = start + (uint64_t)((double)callOffsets[i] / speed);
+            uint64_t now = clock_gettime_nsec_np(CLOCK_UPTIME_RAW);
+            if (now < target) {
+                struct timespec delay = {(time_t)((target - now) / NSEC_PER_SEC), (long)((target - now) % NSEC_PER_SEC)};
+                nanosleep(&delay, NULL);
+            }
+        }
+        uint64_t callStart = clock_gettime_nsec_np(CLOCK_UPTIME_RAW);
+        @autoreleasepool {
+            calls[i]();
+        }
+        latencies[i] = clock_gettime_nsec_np(CLOCK_UPTIME_RAW) - callStart;
+    }
+    if (nil != _loggingQueue) {
+        [self waitForPendingEvents];
+    }
+    uint64_t duration = clock_gettime_nsec_np(CLOCK_UPTIME_RAW) - start;
+    int64_t footprintAfter = AAHReplayFootprint();
+    uint64_t droppedAfter = AAHReplayDroppedEventCount();
+    
+    qsort_b(latencies, count, sizeof(uint64_t), ^int(const void *a, const void *b) {
+        uint64_t left = *(const uint64_t *)a;
+        uint64_t right = *(const uint64_t *)b;
+        return (left > right) - (left < right);
+    });
+    NSDictionary *results = @{
+        @"call_count": @(count),
+        @"duration_ms": @((double)duration / NSEC_PER_MSEC),
+        @"calls_per_second": @((double)count * NSEC_PER_SEC / (double)MAX(duration, (uint64_t)1)),
+        @"p50_latency_us": @((double)latencies[(count - 1) * 50 / 100] / NSEC_PER_USEC),
+        @"p99_latency_us": @((double)latencies[(count - 1) * 99 / 100] / NSEC_PER_USEC),
+        @"max_latency_us": @((double)latencies[count - 1] / NSEC_PER_USEC),
+        @"dropped_events": @(droppedAfter - droppedBefore),
+        @"footprint_growth_bytes": @(footprintAfter - footprintBefore)
+    };
+    free(latencies);
+    return results;
+}
+
+/**
+ * Returns the number of events dropped by the logging buffer, sampling, and rate limiting (for replay results).
+ */
+static uint64_t AAHReplayDroppedEventCount(void) {
+    NSDictionary *throttle = [AAHAnalyticsHelper throttleStatistics];
+    return [AAHAnalyticsHelper droppedEventCount] + [throttle[@"sampled_out"] unsignedLongLongValue] + [throttle[@"rate_limited"] unsignedLongLongValue];
+}
+
+/**
+ * Returns the app's current memory footprint (the figure reported by Xcode and used by the system's memory limits).
+ */
+static int64_t AAHReplayFootprint(void) {
+    task_vm_info_data_t info;
+    mach_msg_type_number_t infoCount = TASK_VM_INFO_COUNT;
+    if (KERN_SUCCESS != task_info(mach_task_self(), TASK_VM_INFO, (task_info_t)&info, &infoCount)) {
+        return 0;
+    }
+    return (int64_t)info.phys_footprint;
+}
+
+// MARK: - Instrumentation
+
+/** Stages of the logging path measured by instrumentation. */
+typedef NS_ENUM(NSUInteger, AAHStage) {
+    AAHStageCall,       // total time spent on the calling thread
+    AAHStageTimestamp,
+    AAHStageValidation,
+    AAHStageTruncation,
+    AAHStageFirebase,   // hand-off to FIRAnalytics
+    AAHStageCount
+};
+static const char * const kInstrumentationStageNames[AAHStageCount] = {"call", "timestamp", "validation", "truncation", "firebase"};
+
+/** Number of latency histogram buckets. Bucket i counts durations under 2^i microseconds (the last bucket counts the rest). */
+#define kInstrumentationHistogramBuckets 16
+
+/** Private class variables for instrumentation (see setInstrumentationSampleRate: below). */
+static BOOL _instrumentationEnabled = NO;
+static os_log_t _signpostLog = nil;
+static mach_timebase_info_data_t _machTimebase;
+static _Atomic(uint64_t) _stageHistograms[AAHStageCount][kInstrumentationHistogramBuckets];
+static _Atomic(uint64_t) _stageNanoseconds[AAHStageCount];
+static NSMutableDictionary<NSString *, NSNumber *> *_eventCounts = nil;
+static NSMutableDictionary<NSString *, NSNumber *> *_eventNanoseconds = nil;
+static os_unfair_lock _eventCountsLock = OS_UNFAIR_LOCK_INIT;
+
+/** Start time and signpost interval of a stage being measured. */
+typedef struct {
+    uint64_t start;
+    os_signpost_id_t signpost;
+} AAHStageTimer;
+
+/**
+ * Starts measuring a stage. Does nothing (beyond one flag check) unless instrumentation is enabled.
+ */
+static inline AAHStageTimer AAHStageBegin(AAHStage stage) {
+    AAHStageTimer timer = {0, OS_SIGNPOST_ID_NULL};
+    if (_instrumentationEnabled) {
+        timer.signpost = os_signpost_id_generate(_signpostLog);
+        os_signpost_interval_begin(_signpostLog, timer.signpost, "AAHStage", "%{public}s", kInstrumentationStageNames[stage]);
+        timer.start = mach_absolute_time();
+    }
+    return timer;
+}
+
+/**
+ * Finishes measuring a stage and records its duration in the stage's histogram.
+ *
+ * @return Duration of the stage in nanoseconds, or 0 if it was not measured.
+ */
+static inline uint64_t AAHStageEnd(AAHStage stage, AAHStageTimer timer) {
+    if (0 == timer.start) {
+        return 0;
+    }
+    uint64_t nanoseconds = (mach_absolute_time() - timer.start) * _machTimebase.numer / _machTimebase.denom;
+    os_signpost_interval_end(_signpostLog, timer.signpost, "AAHStage", "%{public}s", kInstrumentationStageNames[stage]);
+    uint64_t microseconds = nanoseconds / 1000;
+    NSUInteger bucket = (0 == microseconds) ? 0 : MIN(64 - __builtin_clzll(microseconds), kInstrumentationHistogramBuckets - 1);
+    atomic_fetch_add_explicit(&_stageHistograms[stage][bucket], 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&_stageNanoseconds[stage], nanoseconds, memory_order_relaxed);
+    return nanoseconds;
+}
+
+/**
+ * Counts a logged event and the time its call spent on the calling thread.
+ */
+static void AAHCountEvent(NSString *name, uint64_t nanoseconds) {
+    if (!_instrumentationEnabled) {
+        return;
+    }
+    os_unfair_lock_lock(&_eventCountsLock);
+    NSString *key = [name copy];
+    _eventCounts[key] = @(_eventCounts[key].unsignedLongLongValue + 1);
+    _eventNanoseconds[key] = @(_eventNanoseconds[key].unsignedLongLongValue + nanoseconds);
+    os_unfair_lock_unlock(&_eventCountsLock);
+}
+
+/**
+ * Creates the signpost log and counters used for instrumentation.
+ */
++ (void)makeInstrumentation {
+    _signpostLog = os_log_create("com.adswerve.AAHAnalyticsHelper", "Performance");
+    mach_timebase_info(&_machTimebase);
+    _eventCounts = [[NSMutableDictionary alloc] init];
+    _eventNanoseconds = [[NSMutableDictionary alloc] init];
+}
+
+/**
+ * Enables instrumentation of the helper's own overhead for a share of sessions. Default is 0 (disabled).
+ *
+ * The decision is made once per call, so call this early in each session (e.g., before configure) with the
+ * share of sessions to measure, or with 1.0 while profiling. Instrumented sessions emit os_signpost intervals
+ * (subsystem "com.adswerve.AAHAnalyticsHelper", category "Performance") for each stage of the logging path,
+ * and collect the counters returned by statisticsSnapshot. Sessions that are not sampled only pay for a flag check.
+ *
+ * @param sampleRate Share of sessions to instrument, from 0.0 (none) to 1.0 (all).
+ */
++ (void)setInstrumentationSampleRate:(double)sampleRate {
+    _instrumentationEnabled = (sampleRate >= 1.0) || (sampleRate > 0.0 && arc4random_uniform(1000000) < sampleRate * 1000000);
+}
+
+/**
+ * Indicates whether this session was sampled for instrumentation.
+ */
++ (BOOL)isInstrumentationEnabled {
+    return _instrumentationEnabled;
+}
+
+/**
+ * Returns the counters collected by instrumentation since the app launched (or since resetStatistics).
+ *
+ * The snapshot contains:
+ * - "enabled": whether this session is instrumented
+ * - "stages": for each stage ("call", "timestamp", "validation", "truncation", "firebase"), its "count",
+ *   "total_us", and "histogram_us" (an array where element i counts durations under 2^i microseconds)
+ * - "events": for each event name, its "count" and the "call_us" spent on the calling thread
+ * - "dropped": number of events dropped by asynchronous logging (see setOverflowPolicy:)
+ * - "intern_table_full": number of times a valid name wasn't interned because the name table was full
+ */
++ (nonnull NSDictionary<NSString *, id> *)statisticsSnapshot {
+    NSMutableDictionary *stages = [NSMutableDictionary dictionaryWithCapacity:AAHStageCount];
+    for (NSUInteger stage = 0; stage < AAHStageCount; stage++) {
+        NSMutableArray<NSNumber *> *histogram = [NSMutableArray arrayWithCapacity:kInstrumentationHistogramBuckets];
+        uint64_t count = 0;
+        for (NSUInteger bucket = 0; bucket < kInstrumentationHistogramBuckets; bucket++) {
+            uint64_t bucketCount = atomic_load_explicit(&_stageHistograms[stage][bucket], memory_order_relaxed);
+            [histogram addObject:@(bucketCount)];
+            count += bucketCount;
+        }
+        uint64_t nanoseconds = atomic_load_explicit(&_stageNanoseconds[stage], memory_order_relaxed);
+        stages[@(kInstrumentationStageNames[stage])] = @{@"count": @(count), @"total_us": @(nanoseconds / 1000), @"histogram_us": histogram};
+    }
+    
+    NSMutableDictionary *events = [NSMutableDictionary dictionary];
+    os_unfair_lock_lock(&_eventCountsLock);
+    [_eventCounts enumerateKeysAndObjectsUsingBlock:^(NSString *name, NSNumber *count, BOOL *stop) {
+        events[name] = @{@"count": count, @"call_us": @(_eventNanoseconds[name].unsignedLongLongValue / 1000)};
+    }];
+    os_unfair_lock_unlock(&_eventCountsLock);
+    
+    return @{@"enabled": @(_instrumentationEnabled), @"stages": stages, @"events": events, @"dropped": @([self droppedEventCount]),
+             @"intern_table_full": @(atomic_load_explicit(&_internFullCount, memory_order_relaxed))};
+}
+
+/**
+ * Clears the counters collected by instrumentation.
+ */
++ (void)resetStatistics {
+    for (NSUInteger stage = 0; stage < AAHStageCount; stage++) {
+        for (NSUInteger bucket = 0; bucket < kInstrumentationHistogramBuckets; bucket++) {
+            atomic_store_explicit(&_stageHistograms[stage][bucket], 0, memory_order_relaxed);
+        }
+        atomic_store_explicit(&_stageNanoseconds[stage], 0, memory_order_relaxed);
+    }
+    os_unfair_lock_lock(&_eventCountsLock);
+    [_eventCounts removeAllObjects];
+    [_eventNanoseconds removeAllObjects];
+    os_unfair_lock_unlock(&_eventCountsLock);
+}
+
+/**
+ * Logs a readable summary of statisticsSnapshot to the console (debug builds only).
+ *
+ * Events are listed by the total time they spent on the calling thread, so the screens and features
+ * that spend the most main-thread time in analytics come first.
+ */
++ (void)dumpStatistics {
+    if (![self isDebugBuild]) {
+        return;
+    }
+    NSDictionary *snapshot = [self statisticsSnapshot];
+    NSMutableString *dump = [NSMutableString stringWithFormat:@"AAHAnalyticsHelper statistics (instrumentation %@)\n", [snapshot[@"enabled"] boolValue] ? @"enabled" : @"disabled"];
+    for (NSUInteger stage = 0; stage < AAHStageCount; stage++) {
+        NSDictionary *stats = snapshot[@"stages"][@(kInstrumentationStageNames[stage])];
+        unsigned long long count = [stats[@"count"] unsignedLongLongValue];
+        unsigned long long total = [stats[@"total_us"] unsignedLongLongValue];
+        [dump appendFormat:@"  %-10s count %llu, total %llu us, mean %.1f us, histogram (<2^i us) %@\n",
+         kInstrumentationStageNames[stage], count, total, count ? (double)total / count : 0.0,
+         [stats[@"histogram_us"] componentsJoinedByString:@" "]];
+    }
+    NSDictionary<NSString *, NSDictionary *> *events = snapshot[@"events"];
+    NSArray<NSString *> *names = [events keysSortedByValueUsingComparator:^NSComparisonResult(NSDictionary *a, NSDictionary *b) {
+        return [b[@"call_us"] compare:a[@"call_us"]];
+    }];
+    for (NSString *name in names) {
+        [dump appendFormat:@"  %@: count %@, call %@ us\n", name, events[name][@"count"], events[name][@"call_us"]];
+    }
+    NSLog(@"%@", dump);
+}
+
+// MARK: - Event sinks
+
+/** Private class variables for event sinks (see addEventSink: below). */
+static BOOL _hasEventSinks = NO;
+static NSArray<AAHEventSinkRegistration *> *_eventSinks = nil;
+static os_unfair_lock _eventSinksLock = OS_UNFAIR_LOCK_INIT;
+static _Atomic(uint64_t) _droppedSinkEventCount;
+
+/**
+ * Registers a destination that receives every event passed to Firebase (e.g., an in-house collector),
+ * after it has been validated and truncated. All sinks share the same immutable event objects.
+ *
+ * Each sink receives its events in order, in batches, on its own serial queue, so a slow sink doesn't
+ * block the caller, Firebase, or other sinks.
+ *
+ * @param sink The sink to add (retained until removed).
+ */
++ (void)addEventSink:(nonnull id<AAHEventSink>)sink {
+    AAHEventSinkRegistration *registration = [[AAHEventSinkRegistration alloc] initWithSink:sink];
+    os_unfair_lock_lock(&_eventSinksLock);
+    // copy on write, so delivery can use a snapshot without holding the lock
+    _eventSinks = (nil == _eventSinks) ? @[registration] : [_eventSinks arrayByAddingObject:registration];
+    _hasEventSinks = YES;
+    os_unfair_lock_unlock(&_eventSinksLock);
+}
+
+/**
+ * Unregisters a sink added with addEventSink:. Events already queued for it are still delivered.
+ *
+ * @param sink The sink to remove.
+ */
++ (void)removeEventSink:(nonnull id<AAHEventSink>)sink {
+    os_unfair_lock_lock(&_eventSinksLock);
+    _eventSinks = [_eventSinks objectsAtIndexes:[_eventSinks indexesOfObjectsPassingTest:^BOOL(AAHEventSinkRegistration *registration, NSUInteger i, BOOL *stop) {
+        return registration.sink != sink;
+    }]];
+    _hasEventSinks = (_eventSinks.count > 0);
+    os_unfair_lock_unlock(&_eventSinksLock);
+}
+
+/**
+ * Returns the number of events dropped for sinks that fell too far behind (the oldest of 1000 pending events is
+ * dropped for each new one).
+ */
++ (NSUInteger)droppedSinkEventCount {
+    return (NSUInteger)atomic_load_explicit(&_droppedSinkEventCount, memory_order_relaxed);
+}
+
+/**
+ * Passes an event that was just handed to Firebase to each registered sink.
+ *
+ * @param name The name of the event.
+ * @param parameters Parameters as passed to Firebase.
+ */
++ (void)deliverEventToSinksWithName:(nonnull NSString *)name parameters:(nonnull NSDictionary *)parameters {
+    os_unfair_lock_lock(&_eventSinksLock);
+    NSArray<AAHEventSinkRegistration *> *sinks = _eventSinks;
+    os_unfair_lock_unlock(&_eventSinksLock);
+    // one immutable event shared by all sinks (copying an immutable dictionary doesn't copy it)
+    AAHAnalyticsEvent *event = [AAHAnalyticsEvent eventWithName:name parameters:parameters];
+    for (AAHEventSinkRegistration *registration in sinks) {
+        [registration enqueueEvent:event];
+    }
+}
+
+/**
+ * Passes an event to the registered sinks, if there are any (a single flag test otherwise).
+ */
+static inline void AAHFanOutEvent(NSString *name, NSDictionary *parameters) {
+    if (_hasEventSinks) {
+        [AAHAnalyticsHelper deliverEventToSinksWithName:name parameters:parameters];
+    }
+}
+
+// MARK: - Validation/enforcement of Firebase/GA4 rules
+
+/**
+ * Build flag for compiling validation out entirely, e.g., by adding AAH_VALIDATION=0 to the Preprocessor
+ * Macros of the release configuration. The validation calls below are then removed at compile time,
+ * so the helper only appends parameters and truncates values before calling Firebase.
+ */
+#ifndef AAH_VALIDATION
+#define AAH_VALIDATION 1
+#endif
+
+#if AAH_VALIDATION
+/** Whether validation rules should be applied (resolved from the settings below by updateValidationEnabled). */
+static BOOL _validationEnabled = NO;
+#endif
+
+/**
+ * Determines whether validation rules should be applied. (A single load, or a constant if validation is compiled out.)
+ *
+ * @return True if validation should be applied.
+ */
+static inline BOOL AAHIsValidationEnabled(void) {
+#if AAH_VALIDATION
+    return _validationEnabled;
+#else
+    return NO;
+#endif
+}
+
+/** Firebase rules as defined at https://firebase.google.com/docs/reference/ios/firebaseanalytics/api/reference/Classes/FIRAnalytics */
+static const int kValidationEventMaxParameters = 25;
+static const int kValidationEventNameMaxLength = 40;
+static const int kValidationParameterNameMaxLength = 40;
+static const int kValidationParameterValueMaxLength = 100;
+static const int kValidationUserPropertyNameMaxLength = 24;
+static const int kValidationUserPropertyValueMaxLength = 36;
+static const int kValidationUserIdValueMaxLength = 256;
+
+/** Name prefixes reserved by Firebase (not allowed in event, parameter, or user property names). */
+static const char *const kValidationReservedPrefixes[] = {"ga_", "google_", "firebase_"};
+
+/** Size of the stack buffer used to scan names (must be at least the longest max name length above). */
+#define kValidationNameBufferLength 64
+
+/** Returns true if the character is an ASCII letter. */
+static inline BOOL AAHIsNameLetter(unichar c) {
+    return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z');
+}
+
+/** Returns true if the character is an ASCII letter, digit, or underscore. */
+static inline BOOL AAHIsNameCharacter(unichar c) {
+    return AAHIsNameLetter(c) || (c >= '0' && c <= '9') || c == '_';
+}
+
+/**
+ * Checks a name against the Firebase/GA4 naming rules in a single pass over its UTF-16 characters:
+ * it must start with a letter, contain only letters, digits, and underscores, be no longer than
+ * maxLength, and must not start with a reserved prefix. (Equivalent to the pattern
+ * `^(?!ga_|google_|firebase_)[A-Za-z][A-Za-z0-9_]{0,maxLength-1}$`, without the regex engine.)
+ *
+ * @param name Name to evaluate.
+ * @param maxLength Maximum allowed length of the name.
+ * @return True if the name is valid.
+ */
+static BOOL AAHIsValidName(NSString *name, NSUInteger maxLength) {
+    NSUInteger length = [name length];
+    if (length == 0 || length > maxLength || length > kValidationNameBufferLength) {
+        return NO;
+    }
+    unichar buffer[kValidationNameBufferLength];
+    const unichar *characters = CFStringGetCharactersPtr((__bridge CFStringRef)name);
+    if (NULL == characters) {
+        [name getCharacters:buffer range:NSMakeRange(0, length)];
+        characters = buffer;
+    }
+    if (!AAHIsNameLetter(characters[0])) {
+        return NO;
+    }
+    for (NSUInteger i = 1; i < length; i++) {
+        if (!AAHIsNameCharacter(characters[i])) {
+            return NO;
+        }
+    }
+    // reserved prefixes all start with 'g' or 'f', so most names skip this check
+    if (characters[0] == 'g' || characters[0] == 'f') {
+        for (size_t p = 0; p < sizeof(kValidationReservedPrefixes) / sizeof(kValidationReservedPrefixes[0]); p++) {
+            const char *prefix = kValidationReservedPrefixes[p];
+            NSUInteger i = 0;
+            while (prefix[i] != '\0' && i < length && characters[i] == (unichar)prefix[i]) {
+                i++;
+            }
+            if (prefix[i] == '\0') {
+                return NO;
+            }
+        }
+    }
+    return YES;
+}
+
+/**
+ * Result of checking a name against the Firebase/GA4 naming rules (see AAHCheckName).
+ */
+typedef NS_ENUM(NSInteger, AAHNameCheckResult) {
+    AAHNameCheckResultValid,
+    AAHNameCheckResultInvalid,          // invalid, and the error has not been reported yet
+    AAHNameCheckResultInvalidReported   // invalid, but the error was already reported this session
+};
+
+/** Returns the maximum allowed length of a kind of name. */
+static inline NSUInteger AAHNameMaxLength(AAHNameKind kind) {
+    switch (kind) {
+        case AAHNameKindEvent:
+            return kValidationEventNameMaxLength;
+        case AAHNameKindParameter:
+            return kValidationParameterNameMaxLength;
+        case AAHNameKindUserProperty:
+            return kValidationUserPropertyNameMaxLength;
+    }
+}
+
+/** Number of slots in the set of invalid names already reported (must be a power of 2). */
+#define kReportedNamesCapacity 256
+
+/** Longest probe sequence in the set of reported names, past which an invalid name is reported again. */
+static const NSUInteger kReportedNamesMaxProbes = 8;
+
+/** Invalid names already reported, by hash and kind (0 marks an empty slot). */
+static _Atomic(uint64_t) _reportedInvalidNames[kReportedNamesCapacity];
+
+/**
+ * Records that an invalid name's error is being reported, so it's only reported once per session. Invalid
+ * names aren't interned (so they don't use up IDs), and are remembered by hash instead; two invalid names
+ * with the same hash share an entry.
+ *
+ * @return Whether the name's error was already reported (NO if the set is full, so it is reported again).
+ */
+static BOOL AAHNoteInvalidNameReported(AAHNameKind kind, NSUInteger hash) {
+    uint64_t key = ((uint64_t)hash << 2) | kind;
+    key = (0 == key) ? 1 : key;
+    for (NSUInteger probe = 0; probe < kReportedNamesMaxProbes; probe++) {
+        _Atomic(uint64_t) *slot = &_reportedInvalidNames[(hash + kind + probe) & (kReportedNamesCapacity - 1)];
+        uint64_t expected = 0;
+        if (atomic_compare_exchange_strong_explicit(slot, &expected, key, memory_order_relaxed, memory_order_relaxed)) {
+            return NO;
+        }
+        if (expected == key) {
+            return YES;
+        }
+    }
+    return NO;
+}
+
+/**
+ * Checks a name against the Firebase/GA4 naming rules for its kind, remembering the result with the name's
+ * interned ID so that a name seen before costs a single lock-free lookup. Only valid names are interned; an
+ * invalid name is validated every time, but only reported as such the first time it is seen (see
+ * AAHNoteInvalidNameReported).
+ *
+ * The result for each kind is stored as two bits (checked, valid) set together in one atomic operation,
+ * so only the first thread to check an invalid name reports it.
+ *
+ * @param kind Kind of name (event, parameter, or user property).
+ * @param name Name to evaluate.
+ * @return Whether the name is valid, and if not, whether its error still needs to be reported.
+ */
+static AAHNameCheckResult AAHCheckName(AAHNameKind kind, NSString *name) {
+    NSUInteger maxLength = AAHNameMaxLength(kind);
+    uint8_t checkedBit = (uint8_t)(1u << (2 * kind));
+    uint8_t validBit = (uint8_t)(2u << (2 * kind));
+    AAHNameID nameID = AAHFindName(name, name.hash);
+    if (kAAHNameIDNone == nameID) {
+        if (!AAHIsValidName(name, maxLength)) {
+            return AAHNoteInvalidNameReported(kind, name.hash) ? AAHNameCheckResultInvalidReported : AAHNameCheckResultInvalid;
+        }
+        nameID = AAHInternName(name);
+        if (kAAHNameIDNone != nameID) {
+            // intern table is full otherwise, in which case the name is validated every time
+            atomic_fetch_or_explicit(&_internValidation[nameID], checkedBit | validBit, memory_order_relaxed);
+        }
+        return AAHNameCheckResultValid;
+    }
+    uint8_t state = atomic_load_explicit(&_internValidation[nameID], memory_order_relaxed);
+    if (state & checkedBit) {
+        return (state & validBit) ? AAHNameCheckResultValid : AAHNameCheckResultInvalidReported;
+    }
+    
+    BOOL isValid = AAHIsValidName(name, maxLength);
+    uint8_t previous = atomic_fetch_or_explicit(&_internValidation[nameID], checkedBit | (isValid ? validBit : 0), memory_order_relaxed);
+    if (isValid) {
+        return AAHNameCheckResultValid;
+    }
+    return (previous & checkedBit) ? AAHNameCheckResultInvalidReported : AAHNameCheckResultInvalid;
+}
+
+/**
+ * Returns the ID of a name, interning it if it's valid for its kind. Unlike AAHCheckName, an invalid name
+ * isn't marked as reported, so its error is still reported when an event first uses it.
+ *
+ * @return ID of the name, or kAAHNameIDNone if it's invalid or the table is full.
+ */
+static AAHNameID AAHInternValidName(AAHNameKind kind, NSString *name) {
+    if (!AAHIsValidName(name, AAHNameMaxLength(kind))) {
+        return kAAHNameIDNone;
+    }
+    AAHCheckName(kind, name);   // interns the name and memoizes the result
+    return AAHFindName(name, name.hash);
+}
+
+/**
+ * Returns the ID of a name for a rule (sampling, rate limiting, aggregation, or parameter providers),
+ * interning it if it's a valid event name.
+ *
+ * @return ID of the name, or kAAHNameIDNone if it's invalid (Firebase drops events with such names) or the table is full.
+ */
+static AAHNameID AAHRuleNameID(NSString *name) {
+    return AAHInternValidName(AAHNameKindEvent, name);
+}
+
+/**
+ * Returns the canonical (interned, immutable) instance of a name, so that dictionaries built with it can
+ * compare keys by pointer. Names that are invalid for their kind are copied instead of interned.
+ */
+static NSString *AAHCanonicalName(AAHNameKind kind, NSString *name) {
+    NSString *canonical = AAHInternedName(AAHInternValidName(kind, name));
+    return (nil == canonical) ? [name copy] : canonical;
+}
+
+/** Private class variables for validation/enforcement of Firebase rules (see setters below). */
+static BOOL _validateInDebug = YES;
+static BOOL _validateInProduction = NO;
+static BOOL _throwOnValidationErrorsInDebug = NO;
+static BOOL _sendValidationErrorEvents = NO;
+static BOOL _truncateStringValues = YES;
+
+/**
+ * Controls whether Firebase validation is performed in debug builds. Default is true.
+ */
++ (void)setValidateInDebug:(BOOL)enable {
+    _validateInDebug = enable;
+    [self updateValidationEnabled];
+}
+
+/**
+ * Controls whether Firebase validation in performed in release builds. Default is false.
+ *
+ * If enabled, only sends custom error events to Firebase, no logging or exceptions.
+ */
++ (void)setValidateInProduction:(BOOL)enable {
+    _validateInProduction = enable;
+    [self updateValidationEnabled];
+}
+
+/**
+ * Controls whether custom validation error events are sent to Firebase. Default is false.
+ *
+ * Errors are summarized in one error event per interval (see flushValidationErrors).
+ */
++ (void)setSendValidationErrorEvents:(BOOL)enable { _sendValidationErrorEvents = enable; }
+
+/**
+ * Controls whether InvalidArgument exceptions are thrown for Firebase validation errors
+ * in debug builds. Default is false.
+ */
++ (void)setThrowOnValidationErrorsInDebug:(BOOL)enable { _throwOnValidationErrorsInDebug = enable; }
+
+/**
+ * Controls whether string values in event parameters and user properties are truncated to
+ * the maximum lengths allowed before passing to Firebase. Default is true.
+ *
+ * While "validation" is about awareness of issues, this setting is about "enforcement", to
+ * prevent Firebase from dropping parameters and user properties that exceed the allowable
+ * lengths. If enabled, it applies regardless of build type or whether validation is enabled.
+ *
+ * Alternatively, use truncateParam: and truncateUserProp: to trim only those string values
+ * that may potentially exceed the max.
+ */
++ (void)setTruncateStringValues:(BOOL)enable { _truncateStringValues = enable; }
+
+/**
+ * Resolves whether validation rules should be applied, based on build type and the settings above, so that
+ * the check on each call is a single load (see AAHIsValidationEnabled). Called from configure and the setters.
+ */
++ (void)updateValidationEnabled {
+#if AAH_VALIDATION
+    _validationEnabled = (_validateInDebug && [self isDebugBuild]) || (_validateInProduction && ![self isDebugBuild]);
+#endif
+}
+
+/** Maximum number of validation errors reported per payload (event or default parameters); checking stops once it is used up. */
+static const NSUInteger kValidationErrorBudget = 5;
+
+/**
+ * Checks the event name, parameter count, and parameter names and values against the Firebase/GA4 rules.
+ * (Callers are expected to check AAHIsValidationEnabled first.)
+ *
+ * See: https://firebase.google.com/docs/reference/ios/firebaseanalytics/api/reference/Classes/FIRAnalytics#logeventwithnameparameters
+ *
+ * @param name Name of the event.
+ * @param names Parameter names.
+ * @param values Parameter values.
+ * @param count Number of parameters.
+ */
++ (void)checkEventWithName:(nonnull NSString*)name names:(__unsafe_unretained NSString *_Nonnull const *_Nonnull)names values:(__unsafe_unretained id _Nonnull const *_Nonnull)values count:(NSUInteger)count {
+    NSUInteger errorBudget = kValidationErrorBudget;
+    // validate event name
+    bool isInvalidName = AAHCheckName(AAHNameKindEvent, name) == AAHNameCheckResultInvalid;
+    if (isInvalidName) {
+        NSString *errorMessage = [NSString stringWithFormat:@"Invalid event name '%@'", name];
+        [self reportValidationError:errorMessage errorBudget:&errorBudget];
+    }
+    // validate parameter count
+    bool isInvalidCount = count > kValidationEventMaxParameters;
+    if (isInvalidCount) {
+        NSString *errorMessage = [NSString stringWithFormat:@"Too many parameters in event '%@': contains %ld, max %d", name, count, kValidationEventMaxParameters];
+        [self reportValidationError:errorMessage errorBudget:&errorBudget];
+    }
+    // validate parameters
+    for (NSUInteger i = 0; i < count && errorBudget > 0; i++) {
+        [self checkParameter:values[i] forName:names[i] source:name errorBudget:&errorBudget];
+    }
+}
+
+/**
+ * Checks each event parameter name and value against the Firebase/GA4 rules. (Callers are expected to
+ * check AAHIsValidationEnabled first.)
+ *
+ * See: https://firebase.google.com/docs/reference/ios/firebaseanalytics/api/reference/Classes/FIRAnalytics#logeventwithnameparameters
+ *
+ * @param parameters Dictionary of event parameters.
+ * @param source Source of the parameters (for error message use).
+ */
++ (void)checkParameters:(nonnull NSDictionary*)parameters source:(nonnull NSString*)source {
+    __block NSUInteger errorBudget = kValidationErrorBudget;
+    [parameters enumerateKeysAndObjectsUsingBlock:^(id name, id value, BOOL *stop) {
+        [self checkParameter:value forName:name source:source errorBudget:&errorBudget];
+        *stop = (0 == errorBudget);
+    }];
+}
+
+/**
+ * Checks an event parameter name and value against the Firebase/GA4 rules, including each product of an
+ * Ecommerce "items" array.
+ *
+ * Products are checked in a flat loop over fixed-size stack buffers (or enumerated, if a product is larger than
+ * them), without recursion or per-product allocations.
+ * Error messages are only built once an error is found, and checking stops when the error budget is used up.
+ *
+ * @param value Value of the parameter.
+ * @param name Name of the parameter.
+ * @param source Source of the parameter (for error message use).
+ * @param errorBudget Number of errors the payload may still report (decremented for each error reported).
+ */
++ (void)checkParameter:(nonnull id)value forName:(nonnull id)name source:(nonnull NSString*)source errorBudget:(nonnull NSUInteger *)errorBudget {
+    if (![self checkParameterValue:value forName:name source:source isItem:NO errorBudget:errorBudget]) {
+        return;
+    }
+    if (![value isKindOfClass:[NSArray class]] || ![name isEqual:@"items"]) {
+        return;
+    }
+    // special handling required for Ecommerce "items" parameter, which contains an array of products
+    __unsafe_unretained id productNames[AAH_PARAMETER_LIST_CAPACITY];
+    __unsafe_unretained id productValues[AAH_PARAMETER_LIST_CAPACITY];
+    for (id product in (NSArray *)value) {
+        if (![product isKindOfClass:[NSDictionary class]]) {
+            continue;
+        }
+        NSUInteger count = [product count];
+        if (count > AAH_PARAMETER_LIST_CAPACITY) {
+            // too large for the stack buffers (the product's count is unbounded), so enumerate it instead
+            __block BOOL hasBudget = YES;
+            [(NSDictionary *)product enumerateKeysAndObjectsUsingBlock:^(id productName, id productValue, BOOL *stop) {
+                hasBudget = [self checkParameterValue:productValue forName:productName source:source isItem:YES errorBudget:errorBudget];
+                *stop = !hasBudget;
+            }];
+            if (!hasBudget) {
+                return;
+            }
+            continue;
+        }
+        [(NSDictionary *)product getObjects:productValues andKeys:productNames count:count];
+        for (NSUInteger i = 0; i < count; i++) {
+            if (![self checkParameterValue:productValues[i] forName:productNames[i] source:source isItem:YES errorBudget:errorBudget]) {
+                return;
+            }
+        }
+    }
+}
+
+/**
+ * Checks a single parameter name and (string) value against the Firebase/GA4 rules.
+ *
+ * @param value Value of the parameter.
+ * @param name Name of the parameter.
+ * @param source Source of the parameter (for error message use).
+ * @param isItem Whether the parameter belongs to a product in the "items" array (for error message use).
+ * @param errorBudget Number of errors the payload may still report (decremented for each error reported).
+ * @return False if the error budget is used up.
+ */
++ (BOOL)checkParameterValue:(nonnull id)value forName:(nonnull id)name source:(nonnull NSString*)source isItem:(BOOL)isItem errorBudget:(nonnull NSUInteger *)errorBudget {
+    const char *location = isItem ? " [items]" : "";
+    // validate parameter name
+    bool isInvalidName = AAHCheckName(AAHNameKindParameter, name) == AAHNameCheckResultInvalid;
+    if (isInvalidName) {
+        NSString *errorMessage = [NSString stringWithFormat:@"Invalid parameter name '%@' in '%@%s'", name, source, location];
+        [self reportValidationError:errorMessage errorBudget:errorBudget];
+    }
+    // validate parameter value
+    bool isInvalidValue = [value isKindOfClass:[NSString class]] && [value length] > kValidationParameterValueMaxLength;
+    if (isInvalidValue) {
+        NSString *errorMessage = [NSString stringWithFormat:@"Value too long for parameter '%@' in '%@%s': %@", name, source, location, value];
+        [self reportValidationError:errorMessage errorBudget:errorBudget];
+    }
+    return *errorBudget > 0;
+}
+
+/**
+ * Reports a validation error (see handleValidationError:) and spends one error from the payload's budget.
+ *
+ * @param errorMessage The message to be communicated.
+ * @param errorBudget Number of errors the payload may still report.
+ */
++ (void)reportValidationError:(nonnull NSString*)errorMessage errorBudget:(nonnull NSUInteger *)errorBudget {
+    if (0 == *errorBudget) {
+        return;
+    }
+    [self handleValidationError:errorMessage];
+    *errorBudget -= 1;
+}
+
+/**
+ * Checks the user property name and value against the Firebase/GA4 rules. (Callers are expected to check
+ * AAHIsValidationEnabled first.)
+ *
+ * See: https://firebase.google.com/docs/reference/ios/firebaseanalytics/api/reference/Classes/FIRAnalytics#setuserpropertystringforname
+ *
+ * @param value Value of the user property.
+ * @param name Name of the user property
+ */
++ (void)checkUserProperty:(nullable NSString*)value forName:(nonnull NSString*)name {
+    // validate user property name
+    bool isInvalidName = AAHCheckName(AAHNameKindUserProperty, name) == AAHNameCheckResultInvalid;
+    if (isInvalidName) {
+        NSString *errorMessage = [NSString stringWithFormat:@"Invalid user property name '%@'", name];
+        [self handleValidationError:errorMessage];
+    }
+    // validate user property value
+    bool isInvalidValue = [value length] > kValidationUserPropertyValueMaxLength;
+    if (isInvalidValue) {
+        NSString *errorMessage = [NSString stringWithFormat:@"Value too long for user property '%@': %@", name, value];
+        [self handleValidationError:errorMessage];
+    }
+}
+
+/**
+ * Checks the user ID against the Firebase/GA4 rules. (Callers are expected to check AAHIsValidationEnabled first.)
+ *
+ * See: https://firebase.google.com/docs/reference/ios/firebaseanalytics/api/reference/Classes/FIRAnalytics#setuserid
+ *
+ * @param userID Value of the user ID.
+ */
++ (void)checkUserID:(nullable NSString*)userID {
+    bool isInvalidValue = [userID length] > kValidationUserIdValueMaxLength;
+    if (isInvalidValue) {
+        NSString *errorMessage = [NSString stringWithFormat:@"User ID is too long: %@", userID];
+        [self handleValidationError:errorMessage];
+    }
+}
+
+/**
+ * Handles the validation error by logging it, counting it toward a summary error event, and/or throwing an NSInvalidArgumentException exception.
+ *
+ * Behavior is controlled via the "validation" configuration properties. (Logging and exceptions are limited to debug builds only.)
+ * Identical messages are only logged once per interval (see collectValidationError:).
+ *
+ * @param errorMessage The message to be communicated.message.
+ * @throws NSInvalidArgumentException if exception option is enabled. (Test builds only.)
+ */
++ (void)handleValidationError:(nonnull NSString*)errorMessage {
+    BOOL isNewError = [self collectValidationError:errorMessage];
+    
+    // log error (debug builds only), without blocking the calling thread as NSLog would
+    if (isNewError && [self isDebugBuild]) {
+        os_log_error(AAHValidationLog(), "ERROR: %{public}@", errorMessage);
+    }
+    // NSInvalidArgumentException option (debug builds only)
+    // note that the error still counts toward the next summary error event (see flushValidationErrors)
+    if (_throwOnValidationErrorsInDebug && [self isDebugBuild]) {
+        [[NSException exceptionWithName:NSInvalidArgumentException reason:errorMessage userInfo:nil] raise];
+    }
+    
+}
+
+/** Interval between summary error events, and the most distinct messages counted per interval. */
+static const NSTimeInterval kValidationErrorFlushInterval = 30;
+static const NSUInteger kValidationErrorSinkCapacity = 32;
+
+/** Number of offending names listed in a summary error event. */
+static const NSUInteger kValidationErrorSummaryNames = 3;
+
+/** Private class variables for the validation error sink (see collectValidationError: below). */
+static os_unfair_lock _validationErrorLock = OS_UNFAIR_LOCK_INIT;
+static NSMutableDictionary<NSString *, NSNumber *> *_validationErrorCounts = nil;
+static NSUInteger _validationErrorTotal = 0;
+static BOOL _isValidationErrorFlushScheduled = NO;
+
+/** Returns the log used for validation errors, creating it on first use. */
+static os_log_t AAHValidationLog(void) {
+    static os_log_t log;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        log = os_log_create("com.adswerve.AAHAnalyticsHelper", "Validation");
+    });
+    return log;
+}
+
+/**
+ * Returns the offending name in a validation error message (messages quote it first), or nil if there is none.
+ */
+static NSString *AAHValidationErrorSubject(NSString *errorMessage) {
+    NSRange open = [errorMessage rangeOfString:@"'"];
+    if (NSNotFound == open.location) {
+        return nil;
+    }
+    NSUInteger start = NSMaxRange(open);
+    NSRange close = [errorMessage rangeOfString:@"'" options:0 range:NSMakeRange(start, errorMessage.length - start)];
+    return (NSNotFound == close.location) ? nil : [errorMessage substringWithRange:NSMakeRange(start, close.location - start)];
+}
+
+/** Returns the string shortened to fit in an event parameter, with an ellipsis if it was truncated. */
+static NSString *AAHValidationErrorValue(NSString *value) {
+    if ([value length] <= kValidationParameterValueMaxLength) {
+        return value;
+    }
+    return [NSString stringWithFormat:@"%@...", [value substringToIndex:kValidationParameterValueMaxLength - 3]];
+}
+
+/**
+ * Counts a validation error in the bounded error sink, scheduling a flush at the end of the interval if needed.
+ *
+ * Only the first kValidationErrorSinkCapacity distinct messages in an interval are counted individually (and
+ * logged), but every error counts toward the interval's total, so the cost of an error doesn't depend on how
+ * many occur.
+ *
+ * @param errorMessage The message to be communicated.
+ * @return True if the message is new in this interval and the sink had room for it (i.e., it should be logged).
+ */
++ (BOOL)collectValidationError:(nonnull NSString*)errorMessage {
+    os_unfair_lock_lock(&_validationErrorLock);
+    if (nil == _validationErrorCounts) {
+        _validationErrorCounts = [[NSMutableDictionary alloc] init];
+    }
+    NSNumber *count = _validationErrorCounts[errorMessage];
+    
+    // once the sink is full, other messages are only counted toward the total (and not logged again and again)
+    BOOL isNewError = (nil == count) && _validationErrorCounts.count < kValidationErrorSinkCapacity;
+    if (nil != count || isNewError) {
+        _validationErrorCounts[errorMessage] = @(count.unsignedIntegerValue + 1);
+    }
+    _validationErrorTotal++;
+    BOOL shouldSchedule = !_isValidationErrorFlushScheduled;
+    _isValidationErrorFlushScheduled = YES;
+    os_unfair_lock_unlock(&_validationErrorLock);
+    
+    if (shouldSchedule) {
+        dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(kValidationErrorFlushInterval * NSEC_PER_SEC)), dispatch_get_global_queue(QOS_CLASS_UTILITY, 0), ^{
+            [self flushValidationErrors];
+        });
+    }
+    return isNewError;
+}
+
+/**
+ * Empties the error sink and, if error events are enabled, logs one summary error event for the interval. The
+ * event carries the most frequent message, the total number of errors, and the most frequent offending names.
+ */
++ (void)flushValidationErrors {
+    os_unfair_lock_lock(&_validationErrorLock);
+    NSDictionary<NSString *, NSNumber *> *counts = _validationErrorCounts;
+    NSUInteger total = _validationErrorTotal;
+    _validationErrorCounts = nil;
+    _validationErrorTotal = 0;
+    _isValidationErrorFlushScheduled = NO;
+    os_unfair_lock_unlock(&_validationErrorLock);
+    
+    // error event option (available in debug and production)
+    if (!_sendValidationErrorEvents || 0 == total) {
+        return;
+    }
+    NSArray<NSString *> *messages = [counts keysSortedByValueUsingComparator:^NSComparisonResult(NSNumber *a, NSNumber *b) {
+        return [b compare:a];
+    }];
+    NSMutableOrderedSet<NSString *> *names = [NSMutableOrderedSet orderedSet];
+    for (NSString *message in messages) {
+        NSString *name = AAHValidationErrorSubject(message);
+        if (nil != name) {
+            [names addObject:name];
+        }
+        if (names.count == kValidationErrorSummaryNames) {
+            break;
+        }
+    }
+    NSMutableDictionary *errorParams = [NSMutableDictionary dictionaryWithCapacity:3];
+    errorParams[kAAHAnalyticsHelperParameterErrorMessage] = AAHValidationErrorValue(messages.firstObject);
+    errorParams[kAAHAnalyticsHelperParameterErrorCount] = @(total);
+    if (names.count > 0) {
+        errorParams[kAAHAnalyticsHelperParameterErrorNames] = AAHValidationErrorValue([names.array componentsJoinedByString:@","]);
+    }
+    [FIRAnalytics logEventWithName:kAAHAnalyticsHelperEventValidationError parameters:errorParams];
+}
+
+// MARK: - Firebase/GA4 DebugView
+
+/**
+ * Indicates whether events should be sent to DebugView in the Firebase console and GA4 property.
+ *
+ * Default implementation is based on DEBUG flag, but you can customize this to enable DebugView for
+ * select "release" builds that are used for testing. Do NOT enable for true production builds!
+ *
+ * To enable DebugView, call `[AAHAnalyticsHelper setFirebaseLaunchArguments]` before
+ * calling `[FIRApp configure]`(see below).
+ */
++ (BOOL)sendToDebugView {
+    #if DEBUG
+    return YES;
+    #else
+    return NO;
+    #endif
+}
+
+/**
+ * Forces the app to send Firebase events to the DebugView pane in the Firebase console or GA4 property.
+ *
+ * Useful for testing builds that are not launched directly from Xcode.
+ *
+ * Call this method from your AppDelegate's `application:didFinishLaunchingWithOptions:` method before
+ * calling `[FIRApp configure]`.
+ */
++ (void)setFirebaseLaunchArguments {
+    if ([self sendToDebugView]) {
+        NSMutableArray *newArguments = [NSMutableArray arrayWithArray:[[NSProcessInfo processInfo] arguments]];
+        [newArguments addObject:@"-FIRAnalyticsDebugEnabled"];
+        [newArguments addObject:@"-FIRDebugEnabled"];
+        [newArguments addObject:@"-FIRAnalyticsVerboseLoggingEnabled"];
+        [[NSProcessInfo processInfo] setValue:[newArguments copy] forKey:@"arguments"];
+    }
+}
+
+// MARK: - Google Analytics (UA) dispatch
+
+/**
+ * Dispatch interval for traditional GA360 hits in production builds (the dispatch policy's default base interval).
+ *
+ * FOR USE WITH GOOGLE TAG MANAGER, which imports the Google Analytics
+ * library and exposes the GAI methods.
+ *
+ * By default hits are dispatched every 2 minutes when app is in the foreground.
+ * Do not reduce or you risk excessive network activity and battery drain.
+ */
+static double const kGaProductionDispatchInterval = 120;  // seconds
+
+/** Private class variables for the adaptive dispatch scheduler (see setDispatchPolicy: below). */
+static dispatch_queue_t _dispatchQueue = nil;
+static AAHDispatchPolicy *_dispatchPolicy = nil;
+static nw_path_monitor_t _pathMonitor = nil;
+static BOOL _isNetworkReachable = YES;
+static BOOL _isNetworkExpensive = NO;               // cellular or personal hotspot
+static BOOL _isNetworkConstrained = NO;             // Low Data Mode
+static BOOL _isDispatchInFlight = NO;
+static NSUInteger _dispatchFailures = 0;            // consecutive dispatch errors (for backoff)
+static NSTimeInterval _appliedDispatchInterval = 0;
+static _Atomic(NSUInteger) _eventsSinceDispatch;     // events passed to Firebase since the last dispatch
+static NSUInteger _dispatchFlushThreshold = 0;      // copy of the policy's flush threshold, read on the hot path
+static uint64_t _earlyFlushCount = 0;
+static uint64_t _dispatchErrorCount = 0;
+static uint64_t _pausedCount = 0;
+static uint64_t _piggybackCount = 0;
+static uint64_t _lastDispatchTime = 0;              // clock_gettime_nsec_np(CLOCK_UPTIME_RAW) of the last flush
+static double _dispatchesSaved = 0;                 // estimate, vs. the fixed production interval
+static uint64_t _savingsAccruedAt = 0;
+
+/** Estimated bytes per dispatch beyond the hits themselves (connection setup, TLS, and HTTP headers). */
+static const NSUInteger kDispatchOverheadBytes = 4096;
+
+/**
+ * Sets the policy used to adapt the GA360 (Universal Analytics) dispatch interval. Passing nil restores
+ * the default policy.
+ *
+ * FOR USE WITH GOOGLE TAG MANAGER, which imports the Google Analytics
+ * library and exposes the GAI methods.
+ *
+ * @param policy Dispatch policy (copied).
+ */
++ (void)setDispatchPolicy:(nullable AAHDispatchPolicy *)policy {
+    [self startDispatchScheduler];
+    AAHDispatchPolicy *newPolicy = (nil == policy) ? [[AAHDispatchPolicy alloc] init] : [policy copy];
+    dispatch_async(_dispatchQueue, ^{
+        _dispatchPolicy = newPolicy;
+        _dispatchFlushThreshold = newPolicy.flushThreshold;
+        [self updateDispatchSchedule];
+    });
+}
+
+/**
+ * Returns the dispatch scheduler's current state and counters.
+ *
+ * Keys: "interval" (seconds, or -1 while paused), "events_since_dispatch", "reachable", "expensive", "constrained",
+ * "low_power", "thermal_state", "consecutive_failures", "early_flushes", "piggybacked_dispatches", "dispatch_errors",
+ * "pauses", and estimates of the "dispatches_saved" and "bytes_saved" compared to the fixed production interval.
+ */
++ (nonnull NSDictionary<NSString *, id> *)dispatchStatistics {
+    [self startDispatchScheduler];
+    __block NSDictionary *statistics = nil;
+    dispatch_sync(_dispatchQueue, ^{
+        [self accrueDispatchSavings];
+        uint64_t dispatchesSaved = (uint64_t)MAX(_dispatchesSaved, 0.0);
+        statistics = @{@"interval": @(_appliedDispatchInterval),
+                       @"events_since_dispatch": @(atomic_load_explicit(&_eventsSinceDispatch, memory_order_relaxed)),
+                       @"reachable": @(_isNetworkReachable),
+                       @"expensive": @(_isNetworkExpensive),
+                       @"constrained": @(_isNetworkConstrained),
+                       @"low_power": @([NSProcessInfo processInfo].lowPowerModeEnabled),
+                       @"thermal_state": @([NSProcessInfo processInfo].thermalState),
+                       @"consecutive_failures": @(_dispatchFailures),
+                       @"early_flushes": @(_earlyFlushCount),
+                       @"piggybacked_dispatches": @(_piggybackCount),
+                       @"dispatch_errors": @(_dispatchErrorCount),
+                       @"pauses": @(_pausedCount),
+                       @"dispatches_saved": @(dispatchesSaved),
+                       @"bytes_saved": @(dispatchesSaved * kDispatchOverheadBytes)};
+    });
+    return statistics;
+}
+
+/**
+ * Creates the scheduler's queue and starts monitoring network reachability, Low Power Mode, and thermal state.
+ */
++ (void)startDispatchScheduler {
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        dispatch_queue_attr_t attributes = dispatch_queue_attr_make_with_qos_class(DISPATCH_QUEUE_SERIAL, QOS_CLASS_UTILITY, 0);
+        _dispatchQueue = dispatch_queue_create("com.adswerve.AAHAnalyticsHelper.dispatch", attributes);
+        _dispatchPolicy = [[AAHDispatchPolicy alloc] init];
+        _dispatchFlushThreshold = _dispatchPolicy.flushThreshold;
+        
+        _pathMonitor = nw_path_monitor_create();
+        nw_path_monitor_set_queue(_pathMonitor, _dispatchQueue);
+        nw_path_monitor_set_update_handler(_pathMonitor, ^(nw_path_t path) {
+            BOOL wasHolding = !_isNetworkReachable || _isNetworkExpensive || _isNetworkConstrained;
+            _isNetworkReachable = (nw_path_status_satisfied == nw_path_get_status(path));
+            _isNetworkExpensive = nw_path_is_expensive(path);
+            if (@available(iOS 13.0, *)) {
+                _isNetworkConstrained = nw_path_is_constrained(path);
+            }
+            [self updateDispatchSchedule];
+            BOOL isUnrestricted = _isNetworkReachable && !_isNetworkExpensive && !_isNetworkConstrained;
+            if (wasHolding && isUnrestricted && !_isDispatchInFlight && atomic_load_explicit(&_eventsSinceDispatch, memory_order_relaxed) > 0) {
+                // hits were held while offline or on an expensive network, so send them as one burst
+                [self flushHits];
+            }
+        });
+        nw_path_monitor_start(_pathMonitor);
+        
+        for (NSNotificationName name in @[NSProcessInfoPowerStateDidChangeNotification, NSProcessInfoThermalStateDidChangeNotification]) {
+            [[NSNotificationCenter defaultCenter] addObserverForName:name object:nil queue:nil usingBlock:^(NSNotification * _Nonnull note) {
+                dispatch_async(_dispatchQueue, ^{
+                    [self updateDispatchSchedule];
+                });
+            }];
+        }
+    });
+}
+
+/**
+ * Sets the dispatch interval for GA360 (Universal Analytics) hits sent by Google Tag Manager.
+ *
+ * FOR USE WITH GOOGLE TAG MANAGER, which imports the Google Analytics
+ * library and exposes the GAI methods.
+ *
+ * For debug builds the interval is 1 second so hits go out immediately. For production builds the interval
+ * is chosen by the dispatch policy (see setDispatchPolicy:) from the device's current conditions, and is
+ * updated whenever they change.
+ */
++ (void)setDispatchInterval {
+    if([self isDebugBuild]) {
+        [GAI sharedInstance].logger.logLevel = kGAILogLevelVerbose;
+    }
+    [self startDispatchScheduler];
+    dispatch_async(_dispatchQueue, ^{
+        [self accrueDispatchSavings];
+        _appliedDispatchInterval = 0;   // force the interval to be applied again
+        [self updateDispatchSchedule];
+    });
+}
+
+/**
+ * Computes the dispatch interval for the current conditions and applies it if it changed.
+ *
+ * Runs on the dispatch scheduler's queue.
+ */
++ (void)updateDispatchSchedule {
+    NSTimeInterval interval = [self isDebugBuild] ? 1 : [self adaptiveDispatchInterval];
+    if (interval != _appliedDispatchInterval) {
+        [self accrueDispatchSavings];
+        if (interval < 0 && _appliedDispatchInterval >= 0) {
+            _pausedCount++;
+        }
+        _appliedDispatchInterval = interval;
+        [GAI sharedInstance].dispatchInterval = interval;
+    }
+}
+
+/**
+ * Returns the interval chosen by the dispatch policy for the current conditions, or -1 to pause automatic
+ * dispatch (hits stay queued until conditions improve).
+ */
++ (NSTimeInterval)adaptiveDispatchInterval {
+    AAHDispatchPolicy *policy = _dispatchPolicy;
+    NSProcessInfoThermalState thermalState = [NSProcessInfo processInfo].thermalState;
+    if (!_isNetworkReachable || (policy.pausesWhenThermalStateCritical && thermalState >= NSProcessInfoThermalStateCritical)) {
+        // avoid radio wake-ups that can't succeed, or that would worsen a critical thermal state
+        return -1;
+    }
+    if (_isNetworkConstrained && policy.pausesOnConstrainedNetwork) {
+        // the user asked apps to minimize data use (Low Data Mode), so hold hits for a better connection
+        return -1;
+    }
+    NSTimeInterval interval = policy.baseInterval;
+    if (_isNetworkExpensive) {
+        // fewer, bigger bursts on cellular (hits held meanwhile still go out as soon as Wi-Fi is available)
+        interval *= policy.expensiveNetworkMultiplier;
+    }
+    if ([NSProcessInfo processInfo].lowPowerModeEnabled) {
+        interval *= policy.lowPowerMultiplier;
+    }
+    if (thermalState >= NSProcessInfoThermalStateSerious) {
+        interval *= policy.thermalMultiplier;
+    }
+    if (_dispatchFailures > 0) {
+        // exponential backoff after dispatch errors
+        interval = MAX(interval, policy.baseInterval * pow(2, MIN(_dispatchFailures, (NSUInteger)16)));
+    }
+    return MIN(MAX(interval, policy.minimumInterval), policy.maximumInterval);
+}
+
+/**
+ * Dispatches queued hits now, then updates the backoff state from the result.
+ *
+ * Runs on the dispatch scheduler's queue.
+ */
++ (void)flushHits {
+    _isDispatchInFlight = YES;
+    _lastDispatchTime = clock_gettime_nsec_np(CLOCK_UPTIME_RAW);
+    _dispatchesSaved -= 1;  // an extra dispatch on top of the scheduled ones
+    atomic_store_explicit(&_eventsSinceDispatch, 0, memory_order_relaxed);
+    [[GAI sharedInstance] dispatchWithCompletionHandler:^(GAIDispatchResult result) {
+        dispatch_async(_dispatchQueue, ^{
+            _isDispatchInFlight = NO;
+            [self noteDispatchResult:result];
+        });
+    }];
+}
+
+/**
+ * Updates the backoff state from the result of a dispatch.
+ *
+ * Runs on the dispatch scheduler's queue.
+ */
++ (void)noteDispatchResult:(GAIDispatchResult)result {
+    if (kGAIDispatchError == result) {
+        _dispatchErrorCount++;
+        _dispatchFailures++;
+    } else {
+        _dispatchFailures = 0;
+    }
+    [self updateDispatchSchedule];
+}
+
+/**
+ * Reports that the app itself just used the network (e.g., an API request), so queued hits can piggyback on
+ * the radio being awake instead of waking it later. Cheap enough to call for every request.
+ *
+ * Hits are only sent early while the network is reachable but expensive (on other networks the regular
+ * interval is short anyway), and at most once per the policy's minimum interval.
+ *
+ * FOR USE WITH GOOGLE TAG MANAGER, which imports the Google Analytics
+ * library and exposes the GAI methods.
+ */
++ (void)noteNetworkActivity {
+    if (nil == _dispatchQueue || 0 == atomic_load_explicit(&_eventsSinceDispatch, memory_order_relaxed)) {
+        return;
+    }
+    dispatch_async(_dispatchQueue, ^{
+        uint64_t minimumGap = (uint64_t)(_dispatchPolicy.minimumInterval * NSEC_PER_SEC);
+        BOOL isDue = clock_gettime_nsec_np(CLOCK_UPTIME_RAW) - _lastDispatchTime >= minimumGap;
+        if (_isNetworkReachable && _isNetworkExpensive && !_isNetworkConstrained && !_isDispatchInFlight && isDue) {
+            _piggybackCount++;
+            [self flushHits];
+        }
+    });
+}
+
+/**
+ * Adds the dispatches avoided since the last call to the running estimate, comparing the applied interval to the
+ * fixed production interval (a paused dispatcher avoids all of them). Production builds only.
+ *
+ * Runs on the dispatch scheduler's queue.
+ */
++ (void)accrueDispatchSavings {
+    uint64_t now = clock_gettime_nsec_np(CLOCK_UPTIME_RAW);
+    if (0 != _savingsAccruedAt && ![self isDebugBuild] && 0 != _appliedDispatchInterval) {
+        double elapsed = (double)(now - _savingsAccruedAt) / NSEC_PER_SEC;
+        double applied = (_appliedDispatchInterval < 0) ? 0 : elapsed / _appliedDispatchInterval;
+        _dispatchesSaved += elapsed / kGaProductionDispatchInterval - applied;
+    }
+    _savingsAccruedAt = now;
+}
+
+/**
+ * Counts an event passed to Firebase, and flushes early once the policy's (opt-in) threshold is reached.
+ *
+ * This is not GA's queue depth (GAI doesn't expose it): only the events GTM turns into hits are queued.
+ */
+static inline void AAHNoteFirebaseEvent(void) {
+    NSUInteger pending = atomic_fetch_add_explicit(&_eventsSinceDispatch, 1, memory_order_relaxed) + 1;
+    if (_dispatchFlushThreshold > 0 && 0 == pending % _dispatchFlushThreshold && nil != _dispatchQueue) {
+        dispatch_async(_dispatchQueue, ^{
+            if (_isNetworkReachable && !_isNetworkConstrained && !_isDispatchInFlight) {
+                _earlyFlushCount++;
+                [AAHAnalyticsHelper flushHits];
+            }
+        });
+    }
+}
+
+/** Pieces of the time-budgeted background flush (see sendHitsInBackground below). */
+static const double kDispatchDurationSmoothing = 0.3;           // weight of the latest dispatch in the running estimate
+static const NSTimeInterval kDispatchDurationInitialEstimate = 2;   // seconds, until a dispatch has been measured
+static const NSTimeInterval kDispatchTimeReserve = 1;           // seconds kept in reserve for ending the task
+static NSString *const kDispatchDurationKey = @"com.adswerve.AAHAnalyticsHelper.dispatchDuration";
+static NSString *const kBackgroundFlushReportKey = @"com.adswerve.AAHAnalyticsHelper.backgroundFlush";
+
+/**
+ * Sends any queued hits to GA360 (Universal Analytics) when app enters the background.
+ *
+ * FOR USE WITH GOOGLE TAG MANAGER, which imports the Google Analytics
+ * library and exposes the GAI methods.
+ *
+ * Call this method from your AppDelegate's `applicationWillResignActive:` method, or from
+ * `sceneWillResignActive:` if using Scenes, before the app actually enters the background.
+ * Based on: https://developers.google.com/analytics/devguides/collection/ios/v3/dispatch
+ *
+ * Hits are dispatched one batch at a time while the background task's remaining time can cover another
+ * dispatch, based on a running estimate of how long dispatches take, so iOS doesn't kill the task mid-dispatch.
+ * How the flush ended is recorded for the next launch (see lastBackgroundFlushReport).
+ */
++ (void)sendHitsInBackground {
+    // log held aggregates now so their hits can go out with this flush
+    [self flushAggregatedEvents];
+    [self flushValidationErrors];
+    [self startDispatchScheduler];
+    AAHBackgroundFlush *flush = [[AAHBackgroundFlush alloc] init];
+    flush.pendingHits = atomic_exchange_explicit(&_eventsSinceDispatch, 0, memory_order_relaxed);
+    flush.taskId = [[UIApplication sharedApplication] beginBackgroundTaskWithExpirationHandler:^{
+        [self finishBackgroundFlush:flush reason:@"expired"];
+    }];
+    if (flush.taskId == UIBackgroundTaskInvalid) {
+        return;
+    }
+    dispatch_async(dispatch_get_main_queue(), ^{
+        [self continueBackgroundFlush:flush];
+    });
+}
+
+/**
+ * Dispatches the next batch of hits if the remaining background time allows it, or finishes the flush.
+ *
+ * Runs on the main thread (required for backgroundTimeRemaining). Each step is driven by the previous dispatch's
+ * completion handler, so no block needs to refer to itself.
+ *
+ * @param flush State of the background flush.
+ */
++ (void)continueBackgroundFlush:(AAHBackgroundFlush *)flush {
+    if (flush.isFinished) {
+        return;
+    }
+    NSTimeInterval remaining = [UIApplication sharedApplication].backgroundTimeRemaining;
+    if (remaining < [self dispatchDurationEstimate] + kDispatchTimeReserve) {
+        // stop before the budget runs out; remaining hits stay queued for the next launch
+        [self finishBackgroundFlush:flush reason:@"budget"];
+        return;
+    }
+    CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+    [[GAI sharedInstance] dispatchWithCompletionHandler:^(GAIDispatchResult result) {
+        NSTimeInterval duration = CFAbsoluteTimeGetCurrent() - start;
+        dispatch_async(_dispatchQueue, ^{
+            [self noteDispatchResult:result];
+        });
+        dispatch_async(dispatch_get_main_queue(), ^{
+            flush.dispatchCount++;
+            if (kGAIDispatchGood == result) {
+                [self noteDispatchDuration:duration];
+                [self continueBackgroundFlush:flush];
+            } else {
+                [self finishBackgroundFlush:flush reason:(kGAIDispatchNoData == result) ? @"complete" : @"error"];
+            }
+        });
+    }];
+}
+
+/**
+ * Records how the background flush ended, restores the dispatch interval, and ends the background task.
+ *
+ * @param flush State of the background flush.
+ * @param reason "complete", "budget", "expired", or "error".
+ */
++ (void)finishBackgroundFlush:(AAHBackgroundFlush *)flush reason:(NSString *)reason {
+    if (flush.isFinished) {
+        return;
+    }
+    flush.finished = YES;
+    BOOL isComplete = [reason isEqualToString:@"complete"];
+    NSDictionary *report = @{@"reason": reason,
+                             @"dispatches": @(flush.dispatchCount),
+                             @"hits_left": @(isComplete ? 0 : flush.pendingHits),   // upper bound, see AAHNoteFirebaseEvent
+                             @"date": [NSDate date]};
+    [[NSUserDefaults standardUserDefaults] setObject:report forKey:kBackgroundFlushReportKey];
+    [self setDispatchInterval];
+    [[UIApplication sharedApplication] endBackgroundTask:flush.taskId];
+}
+
+/**
+ * Returns how the most recent background flush ended (typically on the previous launch), or nil if none was recorded.
+ *
+ * Keys: "reason" ("complete", "budget", "expired", or "error"), "dispatches", "hits_left" (an estimated upper
+ * bound on the hits left queued for the next launch), and "date".
+ */
++ (nullable NSDictionary<NSString *, id> *)lastBackgroundFlushReport {
+    return [[NSUserDefaults standardUserDefaults] dictionaryForKey:kBackgroundFlushReportKey];
+}
+
+/**
+ * Returns the running estimate of how long one dispatch takes, in seconds (carried over from previous launches).
+ */
++ (NSTimeInterval)dispatchDurationEstimate {
+    double estimate = [[NSUserDefaults standardUserDefaults] doubleForKey:kDispatchDurationKey];
+    return (estimate > 0) ? estimate : kDispatchDurationInitialEstimate;
+}
+
+/**
+ * Updates the running estimate of how long one dispatch takes (exponentially weighted toward recent dispatches).
+ *
+ * @param duration Duration of the latest dispatch, in seconds.
+ */
++ (void)noteDispatchDuration:(NSTimeInterval)duration {
+    double estimate = kDispatchDurationSmoothing * duration + (1 - kDispatchDurationSmoothing) * [self dispatchDurationEstimate];
+    [[NSUserDefaults standardUserDefaults] setDouble:estimate forKey:kDispatchDurationKey];
+}
+
+// MARK: - Timestamp engine
+
+/**
+ * Cached timezone state for building timestamp strings without an NSDateFormatter.
+ *
+ * Formatting with NSDateFormatter is expensive, so the GMT offset and zone abbreviation are cached
+ * and only refreshed when NSSystemTimeZoneDidChangeNotification fires or the next daylight saving
+ * transition has passed. The timestamp itself is written directly into a fixed-size buffer.
+ */
+static os_unfair_lock _timestampLock = OS_UNFAIR_LOCK_INIT;
+static long _timestampOffsetSeconds = 0;
+static char _timestampZone[32] = "";          // e.g., "GMT-0800 (PST)"
+static double _timestampValidUntil = 0;       // seconds since 1970 (0 forces a refresh)
+
+/**
+ * Marks the cached timezone state as stale so it is rebuilt on next use.
+ */
++ (void)invalidateTimestampTimeZone {
+    os_unfair_lock_lock(&_timestampLock);
+    _timestampValidUntil = 0;
+    os_unfair_lock_unlock(&_timestampLock);
+}
+
+/**
+ * Rebuilds the cached timezone state from the current default timezone.
+ */
++ (void)refreshTimestampTimeZone {
+    [NSTimeZone resetSystemTimeZone];
+    NSTimeZone *timeZone = [NSTimeZone defaultTimeZone];
+    NSDate *now = [NSDate date];
+    long offset = [timeZone secondsFromGMTForDate:now];
+    long absOffset = labs(offset);
+    NSString *abbreviation = [timeZone abbreviationForDate:now] ?: @"GMT";
+    NSDate *nextTransition = [timeZone nextDaylightSavingTimeTransitionAfterDate:now];
+    
+    char zone[sizeof(_timestampZone)];
+    snprintf(zone, sizeof(zone), "GMT%c%02ld%02ld (%s)", offset < 0 ? '-' : '+', absOffset / 3600, (absOffset % 3600) / 60, [abbreviation UTF8String]);
+    
+    os_unfair_lock_lock(&_timestampLock);
+    _timestampOffsetSeconds = offset;
+    memcpy(_timestampZone, zone, sizeof(zone));
+    _timestampValidUntil = (nil == nextTransition) ? DBL_MAX : [nextTransition timeIntervalSince1970];
+    os_unfair_lock_unlock(&_timestampLock);
+}
+
+/**
+ * Returns the cached GMT offset of the current timezone in seconds, refreshing it first if stale.
+ */
++ (long)timestampOffsetSeconds {
+    time_t now = time(NULL);
+    os_unfair_lock_lock(&_timestampLock);
+    BOOL isStale = now >= _timestampValidUntil;
+    long offset = _timestampOffsetSeconds;
+    os_unfair_lock_unlock(&_timestampLock);
+    if (isStale) {
+        [self refreshTimestampTimeZone];
+        return [self timestampOffsetSeconds];
+    }
+    return offset;
+}
+
+/**
+ * Returns string representation of current timestamp (e.g., 2020-02-11 11:26:02.868 GMT-0800 (PST)).
+ */
++ (NSString *)getTimestamp {
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    
+    long offset;
+    char zone[sizeof(_timestampZone)];
+    BOOL isStale;
+    os_unfair_lock_lock(&_timestampLock);
+    isStale = now.tv_sec >= _timestampValidUntil;
+    offset = _timestampOffsetSeconds;
+    memcpy(zone, _timestampZone, sizeof(zone));
+    os_unfair_lock_unlock(&_timestampLock);
+    if (isStale) {
+        // first use, timezone change, or daylight saving transition
+        [self refreshTimestampTimeZone];
+        return [self getTimestamp];
+    }
+    
+    struct tm fields;
+    time_t localSeconds = (time_t)(now.tv_sec + offset);
+    gmtime_r(&localSeconds, &fields);
+    char buffer[64];
+    int length = snprintf(buffer, sizeof(buffer), "%04d-%02d-%02d %02d:%02d:%02d.%03d %s",
+                          fields.tm_year + 1900, fields.tm_mon + 1, fields.tm_mday,
+                          fields.tm_hour, fields.tm_min, fields.tm_sec, (int)(now.tv_usec / 1000), zone);
+    return [[NSString alloc] initWithBytes:buffer length:MIN((size_t)length, sizeof(buffer) - 1) encoding:NSUTF8StringEncoding];
+}
+
+// MARK: - Private convenience methods
+
+/**
+ * Indicates whether this is a debug build.
+ */
++ (BOOL)isDebugBuild {
+    #if DEBUG
+    return YES;
+    #else
+    return NO;
+    #endif
+}
+
+/**
+ * Returns the device's current timezone offset in hours vs GMT (e.g., -8.0, -7.0, 2.0, 1.0).
+ */
++ (NSString *)getTimezoneOffset {
+    // reuses the timestamp engine's cached offset, which is refreshed on timezone changes and DST transitions
+    char buffer[16];
+    int length = snprintf(buffer, sizeof(buffer), "%1.1f", [self timestampOffsetSeconds] / 3600.0);
+    return [[NSString alloc] initWithBytes:buffer length:MIN((size_t)length, sizeof(buffer) - 1) encoding:NSUTF8StringEncoding];
+}
+
+@end
+
+// MARK: - AAHAnalyticsEvent
+
+@implementation AAHAnalyticsEvent
+
++ (instancetype)eventWithName:(NSString *)name parameters:(NSDictionary<NSString *,id> *)parameters {
+    return [[self alloc] initWithName:name parameters:parameters];
+}
+
+- (instancetype)initWithName:(NSString *)name parameters:(NSDictionary<NSString *,id> *)parameters {
+    if (self = [super init]) {
+        _name = [name copy];
+        _parameters = [parameters copy];
+    }
+    return self;
+}
+
+@end
+
+// MARK: - AAHParameterSpec
+
+@implementation AAHParameterSpec
+
++ (instancetype)specWithName:(NSString *)name type:(AAHParameterType)type maxLength:(NSUInteger)maxLength {
+    return [[self alloc] initWithName:name type:type maxLength:maxLength];
+}
+
+- (instancetype)initWithName:(NSString *)name type:(AAHParameterType)type maxLength:(NSUInteger)maxLength {
+    if (self = [super init]) {
+        _name = AAHCanonicalName(AAHNameKindParameter, name);
+        _type = type;
+        _maxLength = (0 == maxLength) ? kValidationParameterValueMaxLength : MIN(maxLength, (NSUInteger)kValidationParameterValueMaxLength);
+    }
+    return self;
+}
+
+@end
+
+// MARK: - AAHEventSchema
+
+@implementation AAHEventSchema {
+    // per-parameter rules as C arrays, so builders don't need to touch the spec objects
+    AAHParameterType _types[kAAHEventSchemaMaxParameters];
+    NSUInteger _maxLengths[kAAHEventSchemaMaxParameters];
+}
+
+/** Registered schemas by event name. */
+static NSMutableDictionary<NSString *, AAHEventSchema *> *_schemas = nil;
+static os_unfair_lock _schemasLock = OS_UNFAIR_LOCK_INIT;
+
++ (void)initialize {
+    if (self == [AAHEventSchema class]) {
+        _schemas = [NSMutableDictionary dictionary];
+        
+        // built-in schemas for the event constants in AAHAnalyticsHelper.h (see AAHScreenViewParameter)
+        [self registerSchemaWithName:kAAHAnalyticsHelperEventScreenView parameters:@[
+            [AAHParameterSpec specWithName:kAAHAnalyticsHelperParameterScreenName type:AAHParameterTypeString maxLength:0],
+            [AAHParameterSpec specWithName:kAAHAnalyticsHelperParameterScreenClass type:AAHParameterTypeString maxLength:0],
+        ]];
+    }
+}
+
++ (instancetype)registerSchemaWithName:(NSString *)name parameters:(NSArray<AAHParameterSpec *> *)parameters {
+    AAHEventSchema *schema = [[self alloc] initWithName:name parameters:parameters];
+    os_unfair_lock_lock(&_schemasLock);
+    _schemas[schema.name] = schema;
+    os_unfair_lock_unlock(&_schemasLock);
+    return schema;
+}
+
++ (nullable instancetype)schemaForName:(NSString *)name {
+    os_unfair_lock_lock(&_schemasLock);
+    AAHEventSchema *schema = _schemas[name];
+    os_unfair_lock_unlock(&_schemasLock);
+    return schema;
+}
+
+- (instancetype)initWithName:(NSString *)name parameters:(NSArray<AAHParameterSpec *> *)parameters {
+    if (self = [super init]) {
+        _name = AAHCanonicalName(AAHNameKindEvent, name);
+        _parameters = [parameters copy];
+        
+        // names are checked here once, instead of every time an event is logged
+        if (AAHIsValidationEnabled()) {
+            if (AAHCheckName(AAHNameKindEvent, _name) == AAHNameCheckResultInvalid) {
+                [AAHAnalyticsHelper handleValidationError:[NSString stringWithFormat:@"Invalid event name '%@' in schema", _name]];
+            }
+            if (_parameters.count > kAAHEventSchemaMaxParameters) {
+                [AAHAnalyticsHelper handleValidationError:[NSString stringWithFormat:@"Too many parameters in schema '%@': contains %ld, max %d", _name, _parameters.count, kAAHEventSchemaMaxParameters]];
+            }
+            for (AAHParameterSpec *spec in _parameters) {
+                if (AAHCheckName(AAHNameKindParameter, spec.name) == AAHNameCheckResultInvalid) {
+                    [AAHAnalyticsHelper handleValidationError:[NSString stringWithFormat:@"Invalid parameter name '%@' in schema '%@'", spec.name, _name]];
+                }
+            }
+        }
+        if (_parameters.count > kAAHEventSchemaMaxParameters) {
+            _parameters = [_parameters subarrayWithRange:NSMakeRange(0, kAAHEventSchemaMaxParameters)];
+        }
+        [_parameters enumerateObjectsUsingBlock:^(AAHParameterSpec *spec, NSUInteger i, BOOL *stop) {
+            self->_types[i] = spec.type;
+            self->_maxLengths[i] = spec.maxLength;
+        }];
+    }
+    return self;
+}
+
+- (AAHEventBuilder *)makeBuilder {
+    return [[AAHEventBuilder alloc] initWithSchema:self];
+}
+
+/** Type of the parameter at the given index (index must be in range). */
+- (AAHParameterType)typeAtIndex:(NSUInteger)index {
+    return _types[index];
+}
+
+/** Maximum string length of the parameter at the given index (index must be in range). */
+- (NSUInteger)maxLengthAtIndex:(NSUInteger)index {
+    return _maxLengths[index];
+}
+
+@end
+
+// MARK: - AAHEventBuilder
+
+@implementation AAHEventBuilder {
+    // fixed-size parameter storage (indexed like the schema's parameters) instead of a dictionary
+    __strong NSString *_strings[kAAHEventSchemaMaxParameters];
+    int64_t _integers[kAAHEventSchemaMaxParameters];
+    double _doubles[kAAHEventSchemaMaxParameters];
+    uint32_t _setMask;  // bit i is set if parameter i has a value
+}
+
+- (instancetype)initWithSchema:(AAHEventSchema *)schema {
+    if (self = [super init]) {
+        _schema = schema;
+    }
+    return self;
+}
+
+/**
+ * Checks that the index refers to a schema parameter of the expected type.
+ */
+- (BOOL)isIndex:(NSUInteger)index ofType:(AAHParameterType)type {
+    if (index < _schema.parameters.count && [_schema typeAtIndex:index] == type) {
+        return YES;
+    }
+    if (AAHIsValidationEnabled()) {
+        [AAHAnalyticsHelper handleValidationError:[NSString stringWithFormat:@"Invalid parameter index %ld for schema '%@'", index, _schema.name]];
+    }
+    return NO;
+}
+
+- (void)setString:(NSString *)value atIndex:(NSUInteger)index {
+    if ([self isIndex:index ofType:AAHParameterTypeString]) {
+        _strings[index] = value;
+        _setMask = (nil == value) ? (_setMask & ~(1u << index)) : (_setMask | (1u << index));
+    }
+}
+
+- (void)setInteger:(int64_t)value atIndex:(NSUInteger)index {
+    if ([self isIndex:index ofType:AAHParameterTypeInteger]) {
+        _integers[index] = value;
+        _setMask |= (1u << index);
+    }
+}
+
+- (void)setDouble:(double)value atIndex:(NSUInteger)index {
+    if ([self isIndex:index ofType:AAHParameterTypeDouble]) {
+        _doubles[index] = value;
+        _setMask |= (1u << index);
+    }
+}
+
+- (void)reset {
+    for (NSUInteger i = 0; i < kAAHEventSchemaMaxParameters; i++) {
+        _strings[i] = nil;
+    }
+    _setMask = 0;
+}
+
+/**
+ * Builds the parameter dictionary for Firebase, applying the schema's string length limits.
+ *
+ * @param timestamp Timestamp parameter value to append.
+ * @param validate Whether to report values that exceed their maximum length.
+ * @param truncate Whether to shorten values that exceed their maximum length.
+ * @return Parameters to pass to Firebase.
+ */
+- (NSDictionary *)makeParametersWithTimestamp:(NSString *)timestamp validate:(BOOL)validate truncate:(BOOL)truncate {
+    id keys[kAAHEventSchemaMaxParameters + 1];
+    id values[kAAHEventSchemaMaxParameters + 1];
+    NSUInteger count = 0;
+    NSArray<AAHParameterSpec *> *specs = _schema.parameters;
+    for (NSUInteger i = 0; i < specs.count; i++) {
+        if (0 == (_setMask & (1u << i))) {
+            continue;
+        }
+        id value = nil;
+        switch ([_schema typeAtIndex:i]) {
+            case AAHParameterTypeString: {
+                NSString *string = _strings[i];
+                NSUInteger maxLength = [_schema maxLengthAtIndex:i];
+                if (string.length > maxLength) {
+                    // bounded value check (names were checked when the schema was registered)
+                    if (validate) {
+                        [AAHAnalyticsHelper handleValidationError:[NSString stringWithFormat:@"Value too long for parameter '%@' in '%@': %@", specs[i].name, _schema.name, string]];
+                    }
+                    if (truncate) {
+                        string = [string substringToIndex:maxLength];
+                    }
+                }
+                value = string;
+                break;
+            }
+            case AAHParameterTypeInteger:
+                value = @(_integers[i]);
+                break;
+            case AAHParameterTypeDouble:
+                value = @(_doubles[i]);
+                break;
+        }
+        keys[count] = specs[i].name;
+        values[count] = value;
+        count++;
+    }
+    keys[count] = kAAHAnalyticsHelperParameterTimestamp;
+    values[count] = timestamp;
+    count++;
+    
+    // append provided parameters (the values above stay retained by this method's arrays, and the provided ones by newValues)
+    if ([AAHAnalyticsHelper hasParameterProviders]) {
+        __unsafe_unretained NSString *providedKeys[kAAHEventSchemaMaxParameters + 1 + kMaxParameterProviders];
+        __unsafe_unretained id providedValues[kAAHEventSchemaMaxParameters + 1 + kMaxParameterProviders];
+        for (NSUInteger i = 0; i < count; i++) {
+            providedKeys[i] = keys[i];
+            providedValues[i] = values[i];
+        }
+        NSMutableArray *newValues = nil;
+        NSUInteger providedCount = [AAHAnalyticsHelper appendProvidedParametersForEventWithName:_schema.name names:providedKeys values:providedValues count:count newValues:&newValues];
+        if (providedCount > count) {
+            return [NSDictionary dictionaryWithObjects:providedValues forKeys:providedKeys count:providedCount];
+        }
+    }
+    return [NSDictionary dictionaryWithObjects:values forKeys:keys count:count];
+}
+
+@end
+
+// MARK: - AAHEventSinkRegistration
+
+/** Default batching for sinks that don't specify it, and the most events held for a sink that falls behind. */
+static const NSUInteger kEventSinkDefaultBatchSize = 50;
+static const NSUInteger kEventSinkMaxPendingEvents = 1000;
+
+@implementation AAHEventSinkRegistration {
+    dispatch_queue_t _queue;
+    NSUInteger _maxBatchSize;
+    NSTimeInterval _maxBatchDelay;
+    os_unfair_lock _lock;
+    NSMutableArray<AAHAnalyticsEvent *> *_pending;
+    BOOL _isDeliveryScheduled;           // delayed delivery (maxBatchDelay) pending
+    BOOL _isImmediateDeliveryScheduled;  // delivery of a full batch queued but not started
+}
+
+- (instancetype)initWithSink:(id<AAHEventSink>)sink {
+    if (self = [super init]) {
+        _sink = sink;
+        dispatch_queue_attr_t attributes = dispatch_queue_attr_make_with_qos_class(DISPATCH_QUEUE_SERIAL, QOS_CLASS_UTILITY, 0);
+        _queue = dispatch_queue_create("com.adswerve.AAHAnalyticsHelper.sink", attributes);
+        _maxBatchSize = [sink respondsToSelector:@selector(maxBatchSize)] ? MAX(sink.maxBatchSize, (NSUInteger)1) : kEventSinkDefaultBatchSize;
+        _maxBatchDelay = [sink respondsToSelector:@selector(maxBatchDelay)] ? MAX(sink.maxBatchDelay, 0.0) : 0;
+        _lock = OS_UNFAIR_LOCK_INIT;
+        _pending = [[NSMutableArray alloc] init];
+    }
+    return self;
+}
+
+- (void)enqueueEvent:(AAHAnalyticsEvent *)event {
+    os_unfair_lock_lock(&_lock);
+    if (_pending.count >= kEventSinkMaxPendingEvents) {
+        // the sink has fallen far behind, so drop its oldest event rather than grow without bound
+        [_pending removeObjectAtIndex:0];
+        atomic_fetch_add_explicit(&_droppedSinkEventCount, 1, memory_order_relaxed);
+    }
+    [_pending addObject:event];
+    
+    // at most one immediate delivery is queued at a time (while the sink is busy, events just accumulate),
+    // plus at most one delayed delivery for a batch that isn't full yet
+    BOOL isImmediate = (_pending.count >= _maxBatchSize || 0 == _maxBatchDelay);
+    BOOL shouldSchedule = isImmediate ? !_isImmediateDeliveryScheduled : !_isDeliveryScheduled;
+    if (isImmediate) {
+        _isImmediateDeliveryScheduled = YES;
+    } else {
+        _isDeliveryScheduled = YES;
+    }
+    os_unfair_lock_unlock(&_lock);
+    
+    if (!shouldSchedule) {
+        return;
+    }
+    // the block keeps the registration alive, so events queued before removeEventSink: are still delivered
+    dispatch_block_t deliver = ^{
+        [self deliverPendingEvents];
+    };
+    if (isImmediate) {
+        dispatch_async(_queue, deliver);
+    } else {
+        dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(_maxBatchDelay * NSEC_PER_SEC)), _queue, deliver);
+    }
+}
+
+/**
+ * Passes pending events to the sink in batches of at most maxBatchSize. Runs on the sink's queue.
+ */
+- (void)deliverPendingEvents {
+    os_unfair_lock_lock(&_lock);
+    NSArray<AAHAnalyticsEvent *> *events = _pending;
+    _pending = [[NSMutableArray alloc] init];
+    _isDeliveryScheduled = NO;
+    _isImmediateDeliveryScheduled = NO;
+    os_unfair_lock_unlock(&_lock);
+    
+    for (NSUInteger start = 0; start < events.count; start += _maxBatchSize) {
+        @autoreleasepool {
+            NSRange range = NSMakeRange(start, MIN(_maxBatchSize, events.count - start));
+            [_sink receiveEvents:(0 == start && range.length == events.count) ? events : [events subarrayWithRange:range]];
+        }
+    }
+}
+
+@end
+
+// MARK: - AAHDispatchPolicy
+
+@implementation AAHDispatchPolicy
+
+- (instancetype)init {
+    if (self = [super init]) {
+        _baseInterval = kGaProductionDispatchInterval;
+        _minimumInterval = 30;
+        _maximumInterval = 1800;
+        _flushThreshold = 0;
+        _lowPowerMultiplier = 4;
+        _thermalMultiplier = 4;
+        _pausesWhenThermalStateCritical = YES;
+        _expensiveNetworkMultiplier = 4;
+        _pausesOnConstrainedNetwork = YES;
+    }
+    return self;
+}
+
+- (id)copyWithZone:(NSZone *)zone {
+    AAHDispatchPolicy *copy = [[[self class] allocWithZone:zone] init];
+    copy.baseInterval = _baseInterval;
+    copy.minimumInterval = _minimumInterval;
+    copy.maximumInterval = _maximumInterval;
+    copy.flushThreshold = _flushThreshold;
+    copy.lowPowerMultiplier = _lowPowerMultiplier;
+    copy.thermalMultiplier = _thermalMultiplier;
+    copy.pausesWhenThermalStateCritical = _pausesWhenThermalStateCritical;
+    copy.expensiveNetworkMultiplier = _expensiveNetworkMultiplier;
+    copy.pausesOnConstrainedNetwork = _pausesOnConstrainedNetwork;
+    return copy;
 }
 
 @end
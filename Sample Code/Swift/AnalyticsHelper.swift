@@ -137,6 +137,47 @@ class AnalyticsHelper {
         }
     }
     
+    /// Logs a batch of events, validating and truncating the whole batch in one pass before passing the events
+    /// to Firebase in order.
+    ///
+    /// Configuration and validation state are only evaluated once for the batch, which makes this more efficient
+    /// than calling logEvent(_:parameters:) for each event (e.g., for a burst of impressions).
+    ///
+    /// - Parameters:
+    ///   - events: Events to log (name and optional dictionary of event parameters), in order.
+    ///   - sharedTimestamp: If true, all events in the batch get the same timestamp parameter.
+    static func logEvents(_ events: [(name: String, parameters: [String: Any]?)], sharedTimestamp: Bool = true) {
+        guard !events.isEmpty else {return}
+        if isConfigured() {
+            // evaluate state once for the whole batch
+            let validate = isValidationEnabled
+            let truncate = truncateStringValues
+            let batchTimestamp = sharedTimestamp ? timestamp : nil
+            
+            // append additional parameters, validate, and truncate each event
+            var prepared = [[String: Any]?]()
+            prepared.reserveCapacity(events.count)
+            for event in events {
+                var newParams: [String: Any] = event.parameters ?? [:]
+                newParams[Param.timestamp] = batchTimestamp ?? timestamp
+                if validate {
+                    checkEvent(event.name, parameters: newParams)
+                }
+                prepared.append(truncate ? truncateParams(newParams) : newParams)
+            }
+            
+            // log updated events to Firebase Analytics
+            for (event, params) in zip(events, prepared) {
+                Analytics.logEvent(event.name, parameters: params)
+            }
+        } else {
+            // pass directly to Firebase
+            for event in events {
+                Analytics.logEvent(event.name, parameters: event.parameters)
+            }
+        }
+    }
+    
     /// Wrapper for Firebase's setDefaultEventParameters method, providing an opportunity to validate the parameters and
     /// enforce Firebase rules before passing them to Firebase.
     ///
@@ -226,7 +267,7 @@ class AnalyticsHelper {
     ///
     /// - Parameter parameters: Dictionary of event parameters to evaluate.
     /// - Returns: Dictionary with string values shortened (if needed).
-    private static func truncateParams(_ parameters: [String: Any]?) -> [String: Any]? {
+    static func truncateParams(_ parameters: [String: Any]?) -> [String: Any]? {  // internal for the benchmarks
         guard parameters != nil else {return parameters}
         var newParams = parameters!
         for (name, value) in newParams {
@@ -237,6 +278,125 @@ class AnalyticsHelper {
         return newParams
     }
     
+    // MARK: - Swift-native events
+    
+    /// Value of an event parameter, kept as a Swift value until the event is passed to Firebase.
+    enum ParameterValue: ExpressibleByStringLiteral, ExpressibleByIntegerLiteral, ExpressibleByFloatLiteral {
+        case string(String)
+        case int(Int)
+        case double(Double)
+        case items([ParameterList])  // Ecommerce "items" parameter (array of products)
+        
+        init(stringLiteral value: String) {
+            self = .string(value)
+        }
+        
+        init(integerLiteral value: Int) {
+            self = .int(value)
+        }
+        
+        init(floatLiteral value: Double) {
+            self = .double(value)
+        }
+    }
+    
+    /// Ordered list of event parameters (or product parameters, for the "items" parameter).
+    ///
+    /// Events have few parameters (25 max), so a linear scan of a small array is cheaper than hashing
+    /// into a dictionary, and no Objective-C container is involved until the event is passed to Firebase.
+    struct ParameterList: ExpressibleByDictionaryLiteral {
+        fileprivate private(set) var entries: [(name: String, value: ParameterValue)] = []
+        
+        init(minimumCapacity: Int = 8) {
+            entries.reserveCapacity(minimumCapacity)
+        }
+        
+        init(dictionaryLiteral elements: (String, ParameterValue)...) {
+            entries.reserveCapacity(elements.count + 1)  // room for the timestamp parameter
+            for (name, value) in elements {
+                self[name] = value
+            }
+        }
+        
+        /// Number of parameters.
+        var count: Int {
+            return entries.count
+        }
+        
+        /// Value of a parameter (setting nil removes the parameter).
+        subscript(name: String) -> ParameterValue? {
+            get {
+                return entries.first(where: {$0.name == name})?.value
+            }
+            set {
+                let index = entries.firstIndex(where: {$0.name == name})
+                switch (index, newValue) {
+                case (let index?, let value?): entries[index].value = value
+                case (let index?, .none): entries.remove(at: index)
+                case (.none, let value?): entries.append((name, value))
+                case (.none, .none): break
+                }
+            }
+        }
+        
+        /// Builds the dictionary passed to Firebase, truncating string values in the same pass (if requested).
+        ///
+        /// This is the only place the parameters are converted to a type that is bridged to Objective-C.
+        fileprivate func dictionary(truncate: Bool) -> [String: Any] {
+            var dictionary = [String: Any](minimumCapacity: entries.count)
+            for (name, value) in entries {
+                switch value {
+                case .string(let stringValue):
+                    dictionary[name] = truncate ? AnalyticsHelper.truncateParamValue(stringValue) : stringValue
+                case .int(let intValue):
+                    dictionary[name] = intValue
+                case .double(let doubleValue):
+                    dictionary[name] = doubleValue
+                case .items(let products):
+                    dictionary[name] = products.map {$0.dictionary(truncate: truncate)}
+                }
+            }
+            return dictionary
+        }
+    }
+    
+    /// Event built from Swift values, for use with logEvent(_:).
+    struct AnalyticsEvent {
+        var name: String
+        var parameters: ParameterList
+        
+        init(_ name: String, parameters: ParameterList = ParameterList()) {
+            self.name = name
+            self.parameters = parameters
+        }
+    }
+    
+    /// Logs an event built from Swift values, validating and truncating it without bridging to Objective-C.
+    ///
+    /// Unlike logEvent(_:parameters:), names are checked with a scan of their UTF-8 bytes (instead of
+    /// NSRegularExpression, which bridges each string to NSString), values are checked without dynamic
+    /// casts from Any, and the event is only converted to a dictionary once, when it's passed to Firebase.
+    ///
+    /// - Parameter event: The event to log.
+    static func logEvent(_ event: AnalyticsEvent) {
+        if isConfigured() {
+            // append additional parameters before logging the event (optional)
+            var newParams = event.parameters
+            newParams[Param.timestamp] = .string(timestamp)  // example: append timestamp parameter
+            
+            // validate event name and parameters before passing event to Firebase
+            if isValidationEnabled {
+                checkEvent(event.name, parameters: newParams)
+            }
+            
+            // log updated event to Firebase Analytics
+            Analytics.logEvent(event.name, parameters: newParams.dictionary(truncate: truncateStringValues))
+        } else {
+            // pass directly to Firebase
+            Analytics.logEvent(event.name, parameters: event.parameters.dictionary(truncate: false))
+        }
+    }
+    
     // MARK: - Validation/enforcement of Firebase rules
     
     /// Firebase rules as defined at https://firebase.google.com/docs/reference/swift/firebaseanalytics/api/reference/Classes/Analytics
@@ -330,6 +490,16 @@ class AnalyticsHelper {
     ///   - parameters: Dictionary of event parameters (optional).
     private static func validateEvent(_ name: String, parameters: [String: Any]?) {
         guard isValidationEnabled else {return}
+        checkEvent(name, parameters: parameters)
+    }
+    
+    /// Checks the event name, parameter count, and parameter names and values against the Firebase/GA4 rules, regardless
+    /// of whether validation is enabled. (Callers are expected to check isValidationEnabled.)
+    ///
+    /// - Parameters:
+    ///   - name: Name of the event.
+    ///   - parameters: Dictionary of event parameters (optional).
+    private static func checkEvent(_ name: String, parameters: [String: Any]?) {
         // validate event name
         let isInvalidName = Validation.eventNameRegex?.numberOfMatches(in: name, range: NSMakeRange(0, name.count)) != 1
         if isInvalidName {
@@ -344,9 +514,9 @@ class AnalyticsHelper {
                 let errorMessage = "Too many parameters in event '\(name)': contains \(parameterCount), max \(Validation.eventMaxParameters)"
                 handleValidationError(errorMessage)
             }
+            // validate parameters
+            checkParameters(parameters!, source: name)
         }
-        // validate parameters
-        validateParameters(parameters, source: name)
     }
     
     /// If validation is enabled, checks each event parameter name and value against the Firebase/GA4 rules.
@@ -358,7 +528,17 @@ class AnalyticsHelper {
     ///   - source: Source of the parameters (for error message use).
     private static func validateParameters(_ parameters: [String: Any]?, source: String) {
         guard isValidationEnabled && parameters != nil else {return}
-        for (name, value) in parameters! {
+        checkParameters(parameters!, source: source)
+    }
+    
+    /// Checks each event parameter name and value against the Firebase/GA4 rules, regardless of whether validation
+    /// is enabled. (Callers are expected to check isValidationEnabled.)
+    ///
+    /// - Parameters:
+    ///   - parameters: Dictionary of event parameters.
+    ///   - source: Source of the parameters (for error message use).
+    static func checkParameters(_ parameters: [String: Any], source: String) {  // internal for the benchmarks
+        for (name, value) in parameters {
             // validate parameter name
             let isInvalidName = Validation.parameterNameRegex?.numberOfMatches(in: name, range: NSMakeRange(0, name.count)) != 1
             if isInvalidName {
@@ -370,7 +550,7 @@ class AnalyticsHelper {
                 // special handling required for Ecommerce "items" parameter, which contains an array of products
                 if let productArray = value as? [[String: Any]] {
                     for product in productArray {
-                        validateParameters(product, source: "\(source) [items]")
+                        checkParameters(product, source: "\(source) [items]")
                     }
                 }
             } else {
@@ -386,6 +566,94 @@ class AnalyticsHelper {
         }
     }
     
+    /// Checks the name and parameters of a Swift-native event against the Firebase/GA4 rules, regardless of
+    /// whether validation is enabled. (Callers are expected to check isValidationEnabled.)
+    ///
+    /// - Parameters:
+    ///   - name: Name of the event.
+    ///   - parameters: Event parameters.
+    private static func checkEvent(_ name: String, parameters: ParameterList) {
+        // validate event name
+        if !isValidName(name, maxLength: Validation.eventNameMaxLength) {
+            let errorMessage = "Invalid event name '\(name)'"
+            handleValidationError(errorMessage)
+        }
+        // validate parameter count
+        let parameterCount = parameters.count
+        if parameterCount > Validation.eventMaxParameters {
+            let errorMessage = "Too many parameters in event '\(name)': contains \(parameterCount), max \(Validation.eventMaxParameters)"
+            handleValidationError(errorMessage)
+        }
+        // validate parameters
+        checkParameters(parameters, source: name)
+    }
+    
+    /// Checks each parameter name and value of a Swift-native event against the Firebase/GA4 rules, regardless
+    /// of whether validation is enabled. (Callers are expected to check isValidationEnabled.)
+    ///
+    /// - Parameters:
+    ///   - parameters: Event parameters.
+    ///   - source: Source of the parameters (for error message use).
+    private static func checkParameters(_ parameters: ParameterList, source: String) {
+        for (name, value) in parameters.entries {
+            // validate parameter name
+            if !isValidName(name, maxLength: Validation.parameterNameMaxLength) {
+                let errorMessage = "Invalid parameter name '\(name)' in '\(source)'"
+                handleValidationError(errorMessage)
+            }
+            // validate parameter value
+            switch value {
+            case .string(let stringValue) where !fitsParamValue(stringValue):
+                let errorMessage = "Value too long for parameter '\(name)' in '\(source)': \(stringValue)"
+                handleValidationError(errorMessage)
+            case .items(let products):
+                for product in products {
+                    checkParameters(product, source: "\(source) [items]")
+                }
+            default:
+                break
+            }
+        }
+    }
+    
+    /// Checks an event or parameter name against the Firebase/GA4 naming rules (the same rules as the name
+    /// regex patterns above) by scanning its UTF-8 bytes, without bridging the name to NSString.
+    ///
+    /// - Parameters:
+    ///   - name: Name to check.
+    ///   - maxLength: Maximum length of the name.
+    /// - Returns: True if the name is valid.
+    @inline(__always)
+    private static func isValidName(_ name: String, maxLength: Int) -> Bool {
+        let utf8 = name.utf8
+        guard let first = utf8.first, utf8.count <= maxLength, isASCIILetter(first) else {return false}
+        for byte in utf8.dropFirst() where !(isASCIILetter(byte) || (byte >= UInt8(ascii: "0") && byte <= UInt8(ascii: "9")) || byte == UInt8(ascii: "_")) {
+            return false
+        }
+        return !(utf8.starts(with: "ga_".utf8) || utf8.starts(with: "google_".utf8) || utf8.starts(with: "firebase_".utf8))
+    }
+    
+    /// Indicates whether a UTF-8 byte is an ASCII letter.
+    @inline(__always)
+    private static func isASCIILetter(_ byte: UInt8) -> Bool {
+        return (byte >= UInt8(ascii: "A") && byte <= UInt8(ascii: "Z")) || (byte >= UInt8(ascii: "a") && byte <= UInt8(ascii: "z"))
+    }
+    
+    /// Indicates whether a string parameter value is within the maximum length.
+    ///
+    /// A string never has more characters than UTF-8 bytes, so the (constant time) byte count settles most
+    /// values, and characters are only counted for long or non-ASCII values.
+    @inline(__always)
+    private static func fitsParamValue(_ value: String) -> Bool {
+        return value.utf8.count <= Validation.parameterValueMaxLength || value.count <= Validation.parameterValueMaxLength
+    }
+    
+    /// Truncates a string parameter value to the maximum length, only allocating a new string if needed.
+    @inline(__always)
+    fileprivate static func truncateParamValue(_ value: String) -> String {
+        return fitsParamValue(value) ? value : String(value.prefix(Validation.parameterValueMaxLength))
+    }
+    
     /// If validation is enabled, checks the user property name and value against the Firebase/GA4 rules.
     ///
     /// See: https://firebase.google.com/docs/reference/swift/firebaseanalytics/api/reference/Classes/Analytics#setuserproperty_forname
@@ -553,7 +821,7 @@ class AnalyticsHelper {
     }
     
     /// String representation of current timestamp.
-    private static var timestamp: String {
+    static var timestamp: String {  // internal for the benchmarks
         let dateFormatter = DateFormatter()
         dateFormatter.dateFormat = "yyyy-MM-dd HH:mm:ss.SSS 'GMT'Z '('z')'"  // 2020-02-11 11:26:02.868 GMT-0800 (PST)
         return dateFormatter.string(from: Date())